@@ -11,14 +11,46 @@
 // DEFINE
 // ==================================================
 
+#define MSG_HUFFMAN_TABLE_BITS 11
+#define HUFFMAN_MAX_CODE_LENGTH	32
+
+// MSG_WriteDeltaEntity sends the integral floats in FLOAT_INT_BITS bits
+#define FLOAT_INT_BITS	13
+#define FLOAT_INT_BIAS	(1 << (FLOAT_INT_BITS - 1))
+
 // ==================================================
 // STRUCTS
 // ==================================================
 
+// Message Huffman codes read back from the engine (see Proxy_huffman.cpp)
+typedef struct proxyMsgHuffman_s
+{
+	qboolean	ready;				// same output as the engine
+	qboolean	nativeBigString;	// same MSG_WriteBigString as the engine
+	uint32_t	codes[256];
+	int			lengths[256];
+	short		tree[HMAX][2];		// > 0 node, < 0 -(symbol + 1), 0 is the NYT leaf which never gets a byte
+	int			numNodes;
+	uint32_t	table[1 << MSG_HUFFMAN_TABLE_BITS];	// symbol | length << 16 (or the node reached)
+} proxyMsgHuffman_t;
+
+// netField table of entityState_t read back from the engine (see Proxy_msgDelta.cpp)
+typedef struct proxyMsgEntityFields_s
+{
+	qboolean	ready;							// same MSG_WriteDeltaEntity as the engine
+	int			numFields;
+	short		fieldWords[ENTITYSTATE_WORDS];	// word of each field in entityState_t
+	int			fieldBits[ENTITYSTATE_WORDS];	// 0 for the floats
+	short		wordFields[ENTITYSTATE_WORDS];	// field of each word, -1 if it isn't sent
+} proxyMsgEntityFields_t;
+
 // ==================================================
 // EXTERN VARIABLE
 // ==================================================
 
+extern proxyMsgHuffman_t proxyMsgHuffman;
+extern proxyMsgEntityFields_t proxyMsgEntityFields;
+
 // ==================================================
 // FUNCTION
 // ==================================================
@@ -44,6 +76,202 @@ void Proxy_SV_Status_f(void);
 extern void (*Original_SV_SendClientGameState)(client_t*);
 void Proxy_SV_SendClientGameState(client_t* client);
 
+extern void (*Original_MSG_WriteDeltaEntity)(msg_t*, entityState_t*, entityState_t*, qboolean);
+void Proxy_MSG_WriteDeltaEntity(msg_t* msg, entityState_t* from, entityState_t* to, qboolean force);
+
+qboolean Proxy_MSG_InitHuffman(void);
+int Proxy_MSG_HuffmanReceive(msg_t* msg);
+qboolean Proxy_MSG_HuffmanBuildTables(void);
+
+qboolean Proxy_MSG_InitEntityFields(void);
+qboolean Proxy_MSG_CheckEntityFields(void);
+void Proxy_MSG_HuffmanWriteDeltaEntity(msg_t* msg, const entityState_t* from, const entityState_t* to, const uint32_t* changedWords, qboolean force);
+
+extern void (*Original_MSG_WriteByte)(msg_t*, int);
+void Proxy_MSG_WriteByte(msg_t* msg, int c);
+
+extern void (*Original_MSG_WriteShort)(msg_t*, int);
+void Proxy_MSG_WriteShort(msg_t* msg, int c);
+
+extern void (*Original_MSG_WriteLong)(msg_t*, int);
+void Proxy_MSG_WriteLong(msg_t* msg, int c);
+
+extern int (*Original_MSG_ReadByte)(msg_t*);
+int Proxy_MSG_ReadByte(msg_t* msg);
+
+// ------------- native msg writer
+// Same output as the engine MSG_Write* functions without
+// the calls into the engine, the codes of the bytes are
+// packed in a 64 bits accumulator before being written.
+
+// Bits are written from the lowest bit of each byte and a byte is
+// cleared when the first bit is written into it (Huff_putBit)
+static inline void Proxy_MSG_PutBits(msg_t* msg, uint64_t bits, int numBits)
+{
+	byte* out = msg->data + (msg->bit >> 3);
+	int shift = msg->bit & 7;
+	uint64_t low = bits << shift;
+	int numBytes = (shift + numBits + 7) >> 3;
+	int i;
+
+	if (shift)
+	{
+		out[0] |= (byte)low;
+	}
+	else
+	{
+		out[0] = (byte)low;
+	}
+
+	for (i = 1; i < numBytes && i < 8; i++)
+	{
+		out[i] = (byte)(low >> (i * 8));
+	}
+
+	if (numBytes > 8)
+	{
+		out[8] = (byte)(bits >> (64 - shift));
+	}
+
+	msg->bit += numBits;
+}
+
+// The codes of the numBytes low bytes of value
+static inline void Proxy_MSG_HuffmanPutBytes(msg_t* msg, uint32_t value, int numBytes)
+{
+	uint64_t bits = 0;
+	int numBits = 0;
+	int i;
+
+	for (i = 0; i < numBytes; i++, value >>= 8)
+	{
+		int length = proxyMsgHuffman.lengths[value & 0xFF];
+
+		if (numBits + length > 64)
+		{
+			Proxy_MSG_PutBits(msg, bits, numBits);
+			bits = 0;
+			numBits = 0;
+		}
+
+		bits |= (uint64_t)proxyMsgHuffman.codes[value & 0xFF] << numBits;
+		numBits += length;
+	}
+
+	Proxy_MSG_PutBits(msg, bits, numBits);
+}
+
+// MSG_WriteBits of numBytes * 8 bits
+static inline void Proxy_MSG_HuffmanWriteBytes(msg_t* msg, uint32_t value, int numBytes)
+{
+	// this isn't an exact overflow check, but close enough
+	if (msg->maxsize - msg->cursize < 4)
+	{
+		msg->overflowed = qtrue;
+
+		return;
+	}
+
+	Proxy_MSG_HuffmanPutBytes(msg, value, numBytes);
+
+	msg->cursize = (msg->bit >> 3) + 1;
+}
+
+// MSG_WriteBits, the bits past the last whole byte are sent first and uncompressed
+static inline void Proxy_MSG_HuffmanWriteBits(msg_t* msg, uint32_t value, int bits)
+{
+	int rawBits = bits & 7;
+
+	if (msg->maxsize - msg->cursize < 4)
+	{
+		msg->overflowed = qtrue;
+
+		return;
+	}
+
+	if (bits < 32)
+	{
+		value &= (1U << bits) - 1;
+	}
+
+	if (rawBits)
+	{
+		Proxy_MSG_PutBits(msg, value & ((1U << rawBits) - 1), rawBits);
+		value >>= rawBits;
+	}
+
+	if (bits >> 3)
+	{
+		Proxy_MSG_HuffmanPutBytes(msg, value, bits >> 3);
+	}
+
+	msg->cursize = (msg->bit >> 3) + 1;
+}
+
+static inline qboolean Proxy_MSG_NativeWrite(msg_t* msg)
+{
+	return (qboolean)(proxyMsgHuffman.ready && !msg->oob && proxy_sv_fastHuffman.integer);
+}
+
+static inline void Proxy_MSG_NativeWriteByte(msg_t* msg, int c)
+{
+	if (!Proxy_MSG_NativeWrite(msg))
+	{
+		server.common.functions.MSG_WriteByte(msg, c);
+
+		return;
+	}
+
+	Proxy_MSG_HuffmanWriteBytes(msg, c & 0xFF, 1);
+}
+
+static inline void Proxy_MSG_NativeWriteShort(msg_t* msg, int c)
+{
+	if (!Proxy_MSG_NativeWrite(msg))
+	{
+		server.common.functions.MSG_WriteShort(msg, c);
+
+		return;
+	}
+
+	Proxy_MSG_HuffmanWriteBytes(msg, c & 0xFFFF, 2);
+}
+
+static inline void Proxy_MSG_NativeWriteLong(msg_t* msg, int c)
+{
+	if (!Proxy_MSG_NativeWrite(msg))
+	{
+		server.common.functions.MSG_WriteLong(msg, c);
+
+		return;
+	}
+
+	Proxy_MSG_HuffmanWriteBytes(msg, (uint32_t)c, 4);
+}
+
+// MSG_WriteData of the string with the chars above 127 replaced by '.'
+static inline void Proxy_MSG_HuffmanWriteBigString(msg_t* msg, const char* s)
+{
+	const byte* c = (const byte*)s;
+
+	do
+	{
+		Proxy_MSG_HuffmanWriteBytes(msg, *c > 127 ? '.' : *c, 1);
+	} while (*c++);
+}
+
+static inline void Proxy_MSG_NativeWriteBigString(msg_t* msg, const char* s)
+{
+	if (!s || !Proxy_MSG_NativeWrite(msg) || !proxyMsgHuffman.nativeBigString || strlen(s) >= BIG_INFO_STRING)
+	{
+		server.common.functions.MSG_WriteBigString(msg, s);
+
+		return;
+	}
+
+	Proxy_MSG_HuffmanWriteBigString(msg, s);
+}
+
 // ------------- common
 
 const char* FS_GetCurrentGameDir(bool emptybase = false);
\ No newline at end of file
@@ -194,7 +194,7 @@ void Proxy_SV_SendClientGameState(client_t* client)
 
 	// NOTE, MRE: all server->client messages now acknowledge
 	// let the client know which reliable clientCommands we have received
-	server.common.functions.MSG_WriteLong(&msg, client->lastClientCommand);
+	Proxy_MSG_NativeWriteLong(&msg, client->lastClientCommand);
 
 	// send any server commands waiting to be sent first.
 	// we have to do this cause we send the client->reliableSequence
@@ -203,17 +203,17 @@ void Proxy_SV_SendClientGameState(client_t* client)
 	server.functions.SV_UpdateServerCommandsToClient(client, &msg);
 
 	// send the gamestate
-	server.common.functions.MSG_WriteByte(&msg, svc_gamestate);
-	server.common.functions.MSG_WriteLong(&msg, client->reliableSequence);
+	Proxy_MSG_NativeWriteByte(&msg, svc_gamestate);
+	Proxy_MSG_NativeWriteLong(&msg, client->reliableSequence);
 
 	// write the configstrings
 	for (start = 0; start < MAX_CONFIGSTRINGS; start++)
 	{
 		if (server.sv->configstrings[start][0])
 		{
-			server.common.functions.MSG_WriteByte(&msg, svc_configstring);
-			server.common.functions.MSG_WriteShort(&msg, start);
-			server.common.functions.MSG_WriteBigString(&msg, server.sv->configstrings[start]);
+			Proxy_MSG_NativeWriteByte(&msg, svc_configstring);
+			Proxy_MSG_NativeWriteShort(&msg, start);
+			Proxy_Configstring_WriteBigString(&msg, start);
 		}
 	}
 
@@ -229,16 +229,16 @@ void Proxy_SV_SendClientGameState(client_t* client)
 			continue;
 		}
 
-		server.common.functions.MSG_WriteByte(&msg, svc_baseline);
-		server.common.functions.MSG_WriteDeltaEntity(&msg, &nullstate, base, qtrue);
+		Proxy_MSG_NativeWriteByte(&msg, svc_baseline);
+		Proxy_MSG_WriteDeltaEntity(&msg, &nullstate, base, qtrue);
 	}
 
-	server.common.functions.MSG_WriteByte(&msg, svc_EOF);
+	Proxy_MSG_NativeWriteByte(&msg, svc_EOF);
 
-	server.common.functions.MSG_WriteLong(&msg, client - server.svs->clients);
+	Proxy_MSG_NativeWriteLong(&msg, client - server.svs->clients);
 
 	// write the checksum feed
-	server.common.functions.MSG_WriteLong(&msg, server.sv->checksumFeed);
+	Proxy_MSG_NativeWriteLong(&msg, server.sv->checksumFeed);
 
 	/*
 	//rwwRMG - send info for the terrain
@@ -292,7 +292,7 @@ void Proxy_SV_SendClientGameState(client_t* client)
 
 	// Proxy -------------->
 	// For old RMG system.
-	server.common.functions.MSG_WriteShort(&msg, 0);
+	Proxy_MSG_NativeWriteShort(&msg, 0);
 	// Proxy <--------------
 
 	// deliver this to the client
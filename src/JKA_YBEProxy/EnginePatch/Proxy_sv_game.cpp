@@ -21,6 +21,9 @@ svEntity_t* Proxy_SV_SvEntityForGentity(sharedEntity_t* gEnt)
 
 	// Proxy -------------->
 	// return &sv.svEntities[ gEnt->s.number ];
-	return &server.sv->svEntities[Proxy_SV_NumForGentity(gEnt)];
+	svEntity_t* svEnt = &server.sv->svEntities[Proxy_SV_NumForGentity(gEnt)];
+
+	// Skip the entities not visible from the cluster of the viewer while building snapshots
+	return Proxy_Snapshot_FilterEntity(gEnt, svEnt, YBEProxy_ReturnAddress());
 	// Proxy <--------------
 }
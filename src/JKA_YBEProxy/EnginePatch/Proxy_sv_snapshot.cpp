@@ -31,6 +31,14 @@ void Proxy_SV_SendMessageToClient(msg_t* msg, client_t* client)
 	// Proxy <--------------
 	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageAcked = -1;
 
+	// Proxy -------------->
+	Proxy_Snapshot_MessageSent(client);
+	Proxy_Relay_Message(client, msg);
+	Proxy_Demo_Message(client, msg);
+	Proxy_Net_BeginBatch();
+	Proxy_Net_BeginPacing(client, msg);
+	// Proxy <--------------
+
 	// send the datagram
 	server.functions.SV_Netchan_Transmit(client, msg);	//msg->cursize, msg->data );
 
@@ -59,6 +67,10 @@ void Proxy_SV_SendMessageToClient(msg_t* msg, client_t* client)
 
 	client->nextSnapshotTime = server.svs->time + rateMsec;
 
+	// Proxy -------------->
+	Proxy_Net_EndPacing(client, rateMsec);
+	// Proxy <--------------
+
 	// don't pile up empty snapshots while connecting
 	if (client->state != CS_ACTIVE)
 	{
@@ -0,0 +1,153 @@
+#include "JKA_YBEProxy/EnginePatch/Proxy_EnginePatch.hpp"
+
+// Proxy -------------->
+// ==================================================
+// Table driven Huffman codec (proxy_sv_fastHuffman)
+// --------------------------------------------------
+// The message Huffman tree of the engine never changes
+// once built, the code of every byte is read back from
+// the engine MSG_WriteByte when the engine is patched and
+// a whole code is written at once instead of walking the
+// tree bit by bit, reading looks up MSG_HUFFMAN_TABLE_BITS
+// bits at once and only walks the tree for longer codes.
+// The codec replaces the engine one only if the codes it
+// read back make a prefix code. The round trips of the
+// codec are checked by the Proxy_HuffmanTest test, not
+// when the server starts.
+// ==================================================
+
+#define HUFFMAN_ENTRY_NODE		0x80000000	// the code is longer than MSG_HUFFMAN_TABLE_BITS, symbol is the node reached
+
+proxyMsgHuffman_t proxyMsgHuffman;
+
+// Huff_offsetReceive, returns NYT on the NYT leaf
+int Proxy_MSG_HuffmanReceive(msg_t* msg)
+{
+	int bit = msg->bit;
+	int node = 0;
+	int child;
+
+	if ((bit >> 3) + 2 < msg->maxsize)
+	{
+		const byte* in = msg->data + (bit >> 3);
+		uint32_t window = ((uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16)) >> (bit & 7);
+		uint32_t entry = proxyMsgHuffman.table[window & ((1 << MSG_HUFFMAN_TABLE_BITS) - 1)];
+
+		if (!(entry & HUFFMAN_ENTRY_NODE))
+		{
+			msg->bit = bit + (entry >> 16);
+
+			return entry & 0xFFFF;
+		}
+
+		node = entry & 0xFFFF;
+		bit += MSG_HUFFMAN_TABLE_BITS;
+	}
+
+	for (;;)
+	{
+		child = proxyMsgHuffman.tree[node][(msg->data[bit >> 3] >> (bit & 7)) & 1];
+		bit++;
+
+		if (child <= 0)
+		{
+			msg->bit = bit;
+
+			return child ? -child - 1 : NYT;
+		}
+
+		node = child;
+	}
+}
+
+/*
+==================
+Proxy_MSG_HuffmanBuildTables
+
+The tree and the table of the codes and lengths of
+proxyMsgHuffman, qfalse when they aren't a prefix code
+==================
+*/
+qboolean Proxy_MSG_HuffmanBuildTables(void)
+{
+	int symbol, i;
+
+	Com_Memset(proxyMsgHuffman.tree, 0, sizeof(proxyMsgHuffman.tree));
+	Com_Memset(proxyMsgHuffman.table, 0, sizeof(proxyMsgHuffman.table));
+	proxyMsgHuffman.numNodes = 1;
+
+	for (symbol = 0; symbol < 256; symbol++)
+	{
+		int length = proxyMsgHuffman.lengths[symbol];
+		int node = 0;
+
+		if (length <= 0 || length > HUFFMAN_MAX_CODE_LENGTH)
+		{
+			return qfalse;
+		}
+
+		for (i = 0; i < length; i++)
+		{
+			int bit = (proxyMsgHuffman.codes[symbol] >> i) & 1;
+			short* child = &proxyMsgHuffman.tree[node][bit];
+
+			if (i == length - 1)
+			{
+				// Not a prefix code, that's not the tree we know
+				if (*child)
+				{
+					return qfalse;
+				}
+
+				*child = (short)(-symbol - 1);
+			}
+			else
+			{
+				if (*child < 0)
+				{
+					return qfalse;
+				}
+
+				if (!*child)
+				{
+					if (proxyMsgHuffman.numNodes >= HMAX)
+					{
+						return qfalse;
+					}
+
+					*child = (short)proxyMsgHuffman.numNodes++;
+				}
+
+				node = *child;
+			}
+		}
+	}
+
+	// Every window of MSG_HUFFMAN_TABLE_BITS bits ends on a leaf or on a node
+	for (i = 0; i < (1 << MSG_HUFFMAN_TABLE_BITS); i++)
+	{
+		int node = 0;
+		int length;
+
+		for (length = 1; length <= MSG_HUFFMAN_TABLE_BITS; length++)
+		{
+			int child = proxyMsgHuffman.tree[node][(i >> (length - 1)) & 1];
+
+			if (child <= 0)
+			{
+				proxyMsgHuffman.table[i] = (child ? -child - 1 : NYT) | (length << 16);
+				break;
+			}
+
+			node = child;
+		}
+
+		if (length > MSG_HUFFMAN_TABLE_BITS)
+		{
+			proxyMsgHuffman.table[i] = node | HUFFMAN_ENTRY_NODE;
+		}
+	}
+
+	return qtrue;
+}
+// Proxy <--------------
@@ -0,0 +1,529 @@
+#include "JKA_YBEProxy/EnginePatch/Proxy_EnginePatch.hpp"
+
+// Proxy -------------->
+// Bits are written from the lowest bit of each byte and a byte is
+// cleared when the first bit is written into it (Huff_putBit)
+static void Proxy_MSG_CopyBitsFrom(const msg_t* msg, int startBit, int numBits, byte* out)
+{
+	const byte* in = msg->data + (startBit >> 3);
+	int shift = startBit & 7;
+	int numBytes = (numBits + 7) >> 3;
+	int lastByte = (startBit + numBits - 1) >> 3;
+	int i;
+
+	if (!shift)
+	{
+		memcpy(out, in, numBytes);
+	}
+	else
+	{
+		for (i = 0; i < numBytes; i++)
+		{
+			out[i] = (byte)(in[i] >> shift);
+
+			if ((startBit >> 3) + i + 1 <= lastByte)
+			{
+				out[i] |= (byte)(in[i + 1] << (8 - shift));
+			}
+		}
+	}
+
+	if (numBits & 7)
+	{
+		out[numBytes - 1] &= (byte)((1 << (numBits & 7)) - 1);
+	}
+}
+
+static void Proxy_MSG_CopyBitsTo(msg_t* msg, const byte* bits, int numBits)
+{
+	byte* out = msg->data + (msg->bit >> 3);
+	int shift = msg->bit & 7;
+	int numBytes = (numBits + 7) >> 3;
+	int i;
+
+	if (!shift)
+	{
+		memcpy(out, bits, numBytes);
+	}
+	else
+	{
+		out[0] = (byte)((out[0] & ((1 << shift) - 1)) | (bits[0] << shift));
+
+		for (i = 1; i < numBytes; i++)
+		{
+			out[i] = (byte)((bits[i - 1] >> (8 - shift)) | (bits[i] << shift));
+		}
+
+		if (shift + numBits > numBytes * 8)
+		{
+			out[numBytes] = (byte)(bits[numBytes - 1] >> (8 - shift));
+		}
+	}
+
+	msg->bit += numBits;
+	msg->cursize = (msg->bit >> 3) + 1;
+}
+// Proxy <--------------
+
+/*
+==================
+MSG_WriteDeltaEntity
+
+Writes part of a packetentities message, including the entity number.
+Can delta from either a baseline or a previous packet_entity
+If to is NULL, a remove entity update will be sent
+If force is not set, then nothing at all will be generated if the entity is
+identical, under the assumption that the in-order delta code will catch it.
+==================
+*/
+
+void (*Original_MSG_WriteDeltaEntity)(msg_t*, entityState_t*, entityState_t*, qboolean);
+
+// Proxy -------------->
+static void Proxy_MSG_WriteChangedFields(msg_t* msg, entityState_t* from, entityState_t* to, const uint32_t* changedWords, qboolean force)
+{
+	if (!proxyMsgEntityFields.ready || !Proxy_MSG_NativeWrite(msg))
+	{
+		Original_MSG_WriteDeltaEntity(msg, from, to, force);
+
+		return;
+	}
+
+	Proxy_MSG_HuffmanWriteDeltaEntity(msg, from, to, changedWords, force);
+}
+// Proxy <--------------
+
+void Proxy_MSG_WriteDeltaEntity(msg_t* msg, entityState_t* from, entityState_t* to, qboolean force)
+{
+	// Proxy -------------->
+	entityDelta_t delta;
+	const byte* memoBits;
+	byte* memoOut;
+	uint32_t hash;
+	int numBits;
+	int startBit;
+
+	if (!from || !to || to->number < 0 || to->number >= MAX_GENTITIES)
+	{
+		Original_MSG_WriteDeltaEntity(msg, from, to, force);
+
+		return;
+	}
+
+	// Most of the entities didn't change since the last snapshot, the
+	// changed words are found with SIMD compares (or were found when the
+	// entity got dirty) instead of the netField walk of the engine,
+	// nothing at all is written if there's none
+	if (!Proxy_Delta_Compare(from, to, &delta) && !force)
+	{
+		return;
+	}
+
+	if (!proxy_sv_deltaMemo.integer || msg->oob || msg->overflowed)
+	{
+		Proxy_MSG_WriteChangedFields(msg, from, to, delta.changedWords, force);
+
+		return;
+	}
+
+	// Another client got the same delta during this frame
+	hash = Proxy_Delta_HashEncoding(&delta, from, to, force);
+	memoBits = Proxy_Delta_FindEncoding(&delta, from, to, force, hash, &numBits);
+
+	if (memoBits)
+	{
+		// MSG_WriteBits would overflow somewhere, write it again to overflow at the same place
+		if (msg->maxsize - (((msg->bit + numBits) >> 3) + 1) < 4)
+		{
+			Proxy_MSG_WriteChangedFields(msg, from, to, delta.changedWords, force);
+
+			return;
+		}
+
+		Proxy_MSG_CopyBitsTo(msg, memoBits, numBits);
+
+		return;
+	}
+
+	startBit = msg->bit;
+
+	Proxy_MSG_WriteChangedFields(msg, from, to, delta.changedWords, force);
+
+	if (msg->overflowed || msg->bit <= startBit)
+	{
+		return;
+	}
+
+	memoOut = Proxy_Delta_StoreEncoding(&delta, from, to, force, hash, msg->bit - startBit);
+
+	if (memoOut)
+	{
+		Proxy_MSG_CopyBitsFrom(msg, startBit, msg->bit - startBit, memoOut);
+	}
+	// Proxy <--------------
+}
+
+// Proxy -------------->
+// The code of every byte, as written by the engine
+static qboolean Proxy_MSG_HuffmanReadCodes(void)
+{
+	byte buffer[16];
+	msg_t msg;
+	int symbol, i;
+
+	Com_Memset(&proxyMsgHuffman, 0, sizeof(proxyMsgHuffman));
+
+	for (symbol = 0; symbol < 256; symbol++)
+	{
+		server.common.functions.MSG_Init(&msg, buffer, sizeof(buffer));
+		server.common.functions.MSG_WriteByte(&msg, symbol);
+
+		if (msg.bit <= 0 || msg.bit > HUFFMAN_MAX_CODE_LENGTH)
+		{
+			return qfalse;
+		}
+
+		proxyMsgHuffman.lengths[symbol] = msg.bit;
+
+		for (i = 0; i < msg.bit; i++)
+		{
+			proxyMsgHuffman.codes[symbol] |= (uint32_t)((buffer[i >> 3] >> (i & 7)) & 1) << i;
+		}
+	}
+
+	return qtrue;
+}
+
+static qboolean Proxy_MSG_BigStringSelfTest(void)
+{
+	static byte engineBuffer[BIG_INFO_STRING * 2], nativeBuffer[BIG_INFO_STRING * 2];
+	char string[MAX_STRING_CHARS];
+	msg_t engineMsg, nativeMsg;
+	int i;
+
+	// Every char but 0, in a configstring like string and alone
+	for (i = 0; i < (int)sizeof(string) - 1; i++)
+	{
+		string[i] = (char)(1 + i % 255);
+	}
+
+	string[sizeof(string) - 1] = '\0';
+
+	server.common.functions.MSG_Init(&engineMsg, engineBuffer, sizeof(engineBuffer));
+	server.common.functions.MSG_Init(&nativeMsg, nativeBuffer, sizeof(nativeBuffer));
+
+	server.common.functions.MSG_WriteBigString(&engineMsg, string);
+	server.common.functions.MSG_WriteBigString(&engineMsg, "\\sv_hostname\\^1JKA\\g_gametype\\6");
+	server.common.functions.MSG_WriteBigString(&engineMsg, "");
+
+	Proxy_MSG_HuffmanWriteBigString(&nativeMsg, string);
+	Proxy_MSG_HuffmanWriteBigString(&nativeMsg, "\\sv_hostname\\^1JKA\\g_gametype\\6");
+	Proxy_MSG_HuffmanWriteBigString(&nativeMsg, "");
+
+	return (qboolean)(engineMsg.bit == nativeMsg.bit && engineMsg.cursize == nativeMsg.cursize
+		&& !memcmp(engineBuffer, nativeBuffer, engineMsg.cursize));
+}
+
+// Same bits, same size and same overflow
+static qboolean Proxy_MSG_SameOutput(const msg_t* engineMsg, const msg_t* nativeMsg)
+{
+	return (qboolean)(engineMsg->bit == nativeMsg->bit && engineMsg->cursize == nativeMsg->cursize
+		&& engineMsg->overflowed == nativeMsg->overflowed && !memcmp(engineMsg->data, nativeMsg->data, (engineMsg->bit + 7) >> 3));
+}
+
+/*
+==================
+Proxy_MSG_ReadEntityFields
+
+The field of every word of entityState_t and its bits, from
+what the engine MSG_WriteDeltaEntity writes when only this
+word changed: the number of changes is the field + 1, and
+only the right bits make the native writer write the same
+==================
+*/
+static qboolean Proxy_MSG_ReadEntityFields(void)
+{
+	static byte engineBuffer[256], nativeBuffer[256];
+	uint32_t changedWords[ENTITYSTATE_MASK_WORDS];
+	entityState_t from, to;
+	msg_t engineMsg, nativeMsg, readMsg;
+	int word, bits, field;
+
+	Com_Memset(&proxyMsgEntityFields, 0, sizeof(proxyMsgEntityFields));
+	Com_Memset(&from, 0, sizeof(from));
+	from.number = 1;
+
+	for (word = 0; word < ENTITYSTATE_WORDS; word++)
+	{
+		proxyMsgEntityFields.wordFields[word] = -1;
+	}
+
+	// The number is the first word and isn't a field
+	for (word = 1; word < ENTITYSTATE_WORDS; word++)
+	{
+		to = from;
+		((int*)&to)[word] = -1;
+
+		server.common.functions.MSG_Init(&engineMsg, engineBuffer, sizeof(engineBuffer));
+		Original_MSG_WriteDeltaEntity(&engineMsg, &from, &to, qfalse);
+
+		// Nothing is written when only a word which isn't sent changed
+		if (!engineMsg.bit)
+		{
+			continue;
+		}
+
+		// number (its low bits aren't compressed), not removed, we have a delta, then the number of changes
+		Com_Memset(&readMsg, 0, sizeof(readMsg));
+		readMsg.data = engineBuffer;
+		readMsg.maxsize = sizeof(engineBuffer);
+		readMsg.bit = GENTITYNUM_BITS & 7;
+		Proxy_MSG_HuffmanReceive(&readMsg);
+		readMsg.bit += 2;
+		field = Proxy_MSG_HuffmanReceive(&readMsg) - 1;
+
+		if (field < 0 || field >= ENTITYSTATE_WORDS || proxyMsgEntityFields.wordFields[proxyMsgEntityFields.fieldWords[field]] == field)
+		{
+			return qfalse;
+		}
+
+		proxyMsgEntityFields.wordFields[word] = (short)field;
+		proxyMsgEntityFields.fieldWords[field] = (short)word;
+
+		// Every bit of the value is set, a float is sent as a full float
+		Com_Memset(changedWords, 0, sizeof(changedWords));
+		changedWords[word >> 5] = 1U << (word & 31);
+
+		for (bits = 0; bits <= 32; bits++)
+		{
+			proxyMsgEntityFields.fieldBits[field] = bits;
+
+			server.common.functions.MSG_Init(&nativeMsg, nativeBuffer, sizeof(nativeBuffer));
+			Proxy_MSG_HuffmanWriteDeltaEntity(&nativeMsg, &from, &to, changedWords, qfalse);
+
+			if (Proxy_MSG_SameOutput(&engineMsg, &nativeMsg))
+			{
+				break;
+			}
+		}
+
+		if (bits > 32)
+		{
+			return qfalse;
+		}
+	}
+
+	return Proxy_MSG_CheckEntityFields();
+}
+
+// A word of a state, with the values the fields are written differently for
+static int Proxy_MSG_RandomWord(uint32_t* seed)
+{
+	float value;
+	int word;
+
+	*seed = *seed * 1103515245 + 12345;
+
+	switch ((*seed >> 16) % 8)
+	{
+		case 0:
+			return 0;
+		case 1:
+			return (*seed >> 20) & 0xF;
+		case 2:
+			return -1;
+		case 3:
+			value = (float)((int)((*seed >> 8) % (1 << FLOAT_INT_BITS)) - FLOAT_INT_BIAS);
+			break;
+		case 4:
+			value = (float)((*seed >> 8) & 0xFFFF) / 16.0f - 2048.0f;
+			break;
+		case 5:
+			value = (*seed & 0x100) ? (float)FLOAT_INT_BIAS : -0.0f;
+			break;
+		default:
+			return (int)((*seed << 9) ^ (*seed >> 7));
+	}
+
+	memcpy(&word, &value, sizeof(word));
+
+	return word;
+}
+
+/*
+==================
+Proxy_MSG_DeltaEntitySelfTest
+
+Batches of random deltas, some of them in a message too small
+for the batch, written by the engine and by the native writer
+==================
+*/
+static qboolean Proxy_MSG_DeltaEntitySelfTest(void)
+{
+	static byte engineBuffer[4096], nativeBuffer[4096];
+	uint32_t changedWords[ENTITYSTATE_MASK_WORDS];
+	entityState_t from, to;
+	msg_t engineMsg, nativeMsg;
+	uint32_t seed = 0x2003;
+	int batch, i, word;
+
+	for (batch = 0; batch < 64; batch++)
+	{
+		int maxsize = (batch & 3) ? (int)sizeof(engineBuffer) : 64 + batch;
+
+		server.common.functions.MSG_Init(&engineMsg, engineBuffer, maxsize);
+		server.common.functions.MSG_Init(&nativeMsg, nativeBuffer, maxsize);
+
+		for (i = 0; i < 32; i++)
+		{
+			qboolean force = (qboolean)(i & 1);
+			int numChanges = (batch + i) % 9;
+
+			for (word = 0; word < ENTITYSTATE_WORDS; word++)
+			{
+				((int*)&from)[word] = Proxy_MSG_RandomWord(&seed);
+			}
+
+			to = from;
+
+			while (numChanges--)
+			{
+				seed = seed * 1103515245 + 12345;
+				((int*)&to)[(seed >> 8) % ENTITYSTATE_WORDS] = Proxy_MSG_RandomWord(&seed);
+			}
+
+			from.number = to.number = (batch * 32 + i) % MAX_GENTITIES;
+
+			Original_MSG_WriteDeltaEntity(&engineMsg, &from, &to, force);
+
+			Proxy_Delta_EntityStateChanges(&from, &to, changedWords);
+			Proxy_MSG_HuffmanWriteDeltaEntity(&nativeMsg, &from, &to, changedWords, force);
+
+			if (!Proxy_MSG_SameOutput(&engineMsg, &nativeMsg))
+			{
+				return qfalse;
+			}
+		}
+	}
+
+	return qtrue;
+}
+
+/*
+==================
+Proxy_MSG_InitEntityFields
+
+Reads the netField table of entityState_t back from the
+engine, needs the Huffman codes and the engine
+MSG_WriteDeltaEntity (Original_MSG_WriteDeltaEntity once detoured)
+==================
+*/
+qboolean Proxy_MSG_InitEntityFields(void)
+{
+	if (!Proxy_MSG_ReadEntityFields())
+	{
+		return qfalse;
+	}
+
+	proxyMsgEntityFields.ready = Proxy_MSG_DeltaEntitySelfTest();
+
+	return proxyMsgEntityFields.ready;
+}
+
+qboolean Proxy_MSG_InitHuffman(void)
+{
+	if (!Proxy_MSG_HuffmanReadCodes() || !Proxy_MSG_HuffmanBuildTables())
+	{
+		return qfalse;
+	}
+
+	proxyMsgHuffman.ready = qtrue;
+
+	// The strings are written through the engine if it doesn't do what it's expected to do
+	proxyMsgHuffman.nativeBigString = Proxy_MSG_BigStringSelfTest();
+
+	return qtrue;
+}
+// Proxy <--------------
+
+/*
+=======================
+MSG_WriteByte / MSG_WriteShort / MSG_WriteLong
+
+MSG_WriteBits with 8, 16 and 32 bits
+=======================
+*/
+
+void (*Original_MSG_WriteByte)(msg_t*, int);
+void Proxy_MSG_WriteByte(msg_t* msg, int c)
+{
+	// Proxy -------------->
+	if (msg->oob || !proxy_sv_fastHuffman.integer)
+	{
+		Original_MSG_WriteByte(msg, c);
+
+		return;
+	}
+
+	Proxy_MSG_HuffmanWriteBytes(msg, c & 0xFF, 1);
+	// Proxy <--------------
+}
+
+void (*Original_MSG_WriteShort)(msg_t*, int);
+void Proxy_MSG_WriteShort(msg_t* msg, int c)
+{
+	// Proxy -------------->
+	if (msg->oob || !proxy_sv_fastHuffman.integer)
+	{
+		Original_MSG_WriteShort(msg, c);
+
+		return;
+	}
+
+	Proxy_MSG_HuffmanWriteBytes(msg, c & 0xFFFF, 2);
+	// Proxy <--------------
+}
+
+void (*Original_MSG_WriteLong)(msg_t*, int);
+void Proxy_MSG_WriteLong(msg_t* msg, int c)
+{
+	// Proxy -------------->
+	if (msg->oob || !proxy_sv_fastHuffman.integer)
+	{
+		Original_MSG_WriteLong(msg, c);
+
+		return;
+	}
+
+	Proxy_MSG_HuffmanWriteBytes(msg, (uint32_t)c, 4);
+	// Proxy <--------------
+}
+
+/*
+=======================
+MSG_ReadByte
+=======================
+*/
+
+int (*Original_MSG_ReadByte)(msg_t*);
+int Proxy_MSG_ReadByte(msg_t* msg)
+{
+	int c;
+
+	// Proxy -------------->
+	if (msg->oob || !proxy_sv_fastHuffman.integer)
+	{
+		return Original_MSG_ReadByte(msg);
+	}
+
+	c = (byte)Proxy_MSG_HuffmanReceive(msg);
+	msg->readcount = (msg->bit >> 3) + 1;
+	// Proxy <--------------
+
+	if (msg->readcount > msg->cursize)
+	{
+		c = -1;
+	}
+
+	return c;
+}
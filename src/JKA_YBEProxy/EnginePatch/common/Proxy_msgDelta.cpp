@@ -0,0 +1,235 @@
+#include "JKA_YBEProxy/EnginePatch/Proxy_EnginePatch.hpp"
+
+// Proxy -------------->
+// ==================================================
+// Native entity delta writer (proxy_sv_fastHuffman)
+// --------------------------------------------------
+// MSG_WriteDeltaEntity walks its whole netField table for
+// every entity of every snapshot, comparing each field and
+// writing a bit for each unchanged one up to the last
+// changed field. Here the changed words of the states are
+// found with SIMD compares (Proxy_Delta_EntityStateChanges),
+// only the changed fields are walked and the unchanged
+// fields in between are written as one run of zero bits.
+// The netField table isn't exported by the engine, the
+// field of every word of entityState_t and its bits are
+// read back from the engine MSG_WriteDeltaEntity when the
+// engine is patched, and the writer replaces the engine one
+// only if both write the same bits for a set of random
+// states (Proxy_MSG_InitEntityFields).
+// MSG_WriteDeltaPlayerstate (and the vehicle vps) has no
+// known address in the engine, the playerState_t deltas
+// still go through the engine netField walk.
+// ==================================================
+
+proxyMsgEntityFields_t proxyMsgEntityFields;
+
+// numBits times MSG_WriteBits(msg, 0, 1)
+static void Proxy_MSG_HuffmanWriteZeros(msg_t* msg, int numBits)
+{
+	// The cursize of the last MSG_WriteBits is the highest, none of them overflows if it doesn't
+	if (msg->maxsize - msg->cursize < 4 || msg->maxsize - (((msg->bit + numBits - 1) >> 3) + 1) < 4)
+	{
+		for (; numBits > 0; numBits--)
+		{
+			Proxy_MSG_HuffmanWriteBits(msg, 0, 1);
+		}
+
+		return;
+	}
+
+	while (numBits > 0)
+	{
+		int chunk = numBits < 56 ? numBits : 56;
+
+		Proxy_MSG_PutBits(msg, 0, chunk);
+		numBits -= chunk;
+	}
+
+	msg->cursize = (msg->bit >> 3) + 1;
+}
+
+/*
+==================
+Proxy_MSG_HuffmanWriteDeltaEntity
+
+MSG_WriteDeltaEntity from a state to another one (not NULL),
+changedWords are the words of entityState_t which differ
+==================
+*/
+void Proxy_MSG_HuffmanWriteDeltaEntity(msg_t* msg, const entityState_t* from, const entityState_t* to, const uint32_t* changedWords, qboolean force)
+{
+	const int* toWords = (const int*)to;
+	uint32_t changedFields[ENTITYSTATE_MASK_WORDS];
+	int lc = 0;
+	int nextField = 0;
+	int i;
+
+	memset(changedFields, 0, sizeof(changedFields));
+
+	for (i = 0; i < ENTITYSTATE_MASK_WORDS; i++)
+	{
+		uint32_t bits = changedWords[i];
+
+		while (bits)
+		{
+			int field = proxyMsgEntityFields.wordFields[(i << 5) + YBEProxy_LowestBit(bits)];
+
+			bits &= bits - 1;
+
+			// The number isn't a field
+			if (field < 0)
+			{
+				continue;
+			}
+
+			changedFields[field >> 5] |= 1U << (field & 31);
+
+			if (field >= lc)
+			{
+				lc = field + 1;
+			}
+		}
+	}
+
+	if (!lc)
+	{
+		// nothing at all changed
+		if (!force)
+		{
+			return;
+		}
+
+		// write two bits for no change
+		Proxy_MSG_HuffmanWriteBits(msg, to->number, GENTITYNUM_BITS);
+		Proxy_MSG_HuffmanWriteBits(msg, 0, 1);		// not removed
+		Proxy_MSG_HuffmanWriteBits(msg, 0, 1);		// no delta
+
+		return;
+	}
+
+	Proxy_MSG_HuffmanWriteBits(msg, to->number, GENTITYNUM_BITS);
+	Proxy_MSG_HuffmanWriteBits(msg, 0, 1);			// not removed
+	Proxy_MSG_HuffmanWriteBits(msg, 1, 1);			// we have a delta
+	Proxy_MSG_HuffmanWriteBits(msg, lc, 8);			// # of changes
+
+	for (i = 0; i < ENTITYSTATE_MASK_WORDS; i++)
+	{
+		uint32_t bits = changedFields[i];
+
+		while (bits)
+		{
+			int field = (i << 5) + YBEProxy_LowestBit(bits);
+			int value = toWords[proxyMsgEntityFields.fieldWords[field]];
+
+			bits &= bits - 1;
+
+			// The unchanged fields before this one
+			if (field > nextField)
+			{
+				Proxy_MSG_HuffmanWriteZeros(msg, field - nextField);
+			}
+
+			nextField = field + 1;
+
+			Proxy_MSG_HuffmanWriteBits(msg, 1, 1);	// changed
+
+			if (!proxyMsgEntityFields.fieldBits[field])
+			{
+				float fullFloat;
+
+				memcpy(&fullFloat, &value, sizeof(fullFloat));
+
+				if (fullFloat == 0.0f)
+				{
+					Proxy_MSG_HuffmanWriteBits(msg, 0, 1);
+				}
+				else
+				{
+					Proxy_MSG_HuffmanWriteBits(msg, 1, 1);
+
+					// The range is checked before truncating, the engine truncates
+					// first but the out of range values fail its checks as well
+					if (fullFloat >= -FLOAT_INT_BIAS && fullFloat < (1 << FLOAT_INT_BITS) - FLOAT_INT_BIAS
+						&& (float)(int)fullFloat == fullFloat)
+					{
+						// send as small integer
+						Proxy_MSG_HuffmanWriteBits(msg, 0, 1);
+						Proxy_MSG_HuffmanWriteBits(msg, (int)fullFloat + FLOAT_INT_BIAS, FLOAT_INT_BITS);
+					}
+					else
+					{
+						// send as full floating point value
+						Proxy_MSG_HuffmanWriteBits(msg, 1, 1);
+						Proxy_MSG_HuffmanWriteBits(msg, value, 32);
+					}
+				}
+			}
+			else if (!value)
+			{
+				Proxy_MSG_HuffmanWriteBits(msg, 0, 1);
+			}
+			else
+			{
+				Proxy_MSG_HuffmanWriteBits(msg, 1, 1);
+				Proxy_MSG_HuffmanWriteBits(msg, value, proxyMsgEntityFields.fieldBits[field]);
+			}
+		}
+	}
+}
+
+/*
+==================
+Proxy_MSG_CheckEntityFields
+
+Sets numFields, qfalse unless every field has its own word
+and fits in MSG_WriteBits
+==================
+*/
+qboolean Proxy_MSG_CheckEntityFields(void)
+{
+	int numFields = 0;
+	int numWords = 0;
+	int word, field;
+
+	for (word = 0; word < ENTITYSTATE_WORDS; word++)
+	{
+		field = proxyMsgEntityFields.wordFields[word];
+
+		if (field < 0)
+		{
+			continue;
+		}
+
+		if (field >= ENTITYSTATE_WORDS || proxyMsgEntityFields.fieldWords[field] != word)
+		{
+			return qfalse;
+		}
+
+		if (field >= numFields)
+		{
+			numFields = field + 1;
+		}
+
+		numWords++;
+	}
+
+	// The number of changes is sent in a byte
+	if (!numFields || numWords != numFields || numFields > 255)
+	{
+		return qfalse;
+	}
+
+	for (field = 0; field < numFields; field++)
+	{
+		if (proxyMsgEntityFields.fieldBits[field] < 0 || proxyMsgEntityFields.fieldBits[field] > 32)
+		{
+			return qfalse;
+		}
+	}
+
+	proxyMsgEntityFields.numFields = numFields;
+
+	return qtrue;
+}
+// Proxy <--------------
@@ -0,0 +1,271 @@
+#include "Proxy_Header.hpp"
+
+// ==================================================
+// Challenge index (proxy_sv_challengeHash)
+// --------------------------------------------------
+// SV_GetChallenge and SV_DirectConnect scan the 1024
+// svs.challenges for every getchallenge and connect.
+// getchallenge is answered here the same way, with an
+// open addressing index by address over svs.challenges.
+// The entries are still written to the array, so
+// SV_DirectConnect finds them. SV_GetChallenge evicts the
+// entry with the lowest time, and the time of an entry is
+// when it was created, so that entry is the next one of a
+// ring (entries of the same time go in creation order
+// instead of index order). This is the eviction of the
+// engine and not an LRU: asking again doesn't keep an
+// address longer.
+// A connect from an address without any challenge is
+// rejected here with the message of SV_DirectConnect,
+// only a connect which may be valid goes to the engine
+// and its scan (the challenge number is in the compressed
+// userinfo, the engine checks it). Such a client also
+// gets the challenge message where the engine would have
+// told it about a wrong protocol version first.
+// The packets come from the recvfrom of Proxy_Net.
+// ==================================================
+
+#ifndef _MSC_VER
+
+#include <netinet/in.h>
+
+#define CHALLENGE_HASH_SIZE		2048	// power of 2, twice MAX_CHALLENGES
+
+static struct ChallengeIndex_s {
+	qboolean	built;
+	int			next;							// the oldest entry, replaced by the next new address
+	short		slots[CHALLENGE_HASH_SIZE];		// challenge number + 1, 0 is empty
+} challengeIndex;
+
+static int Proxy_Challenge_Hash(const netadr_t* adr)
+{
+	uint32_t ip;
+
+	memcpy(&ip, adr->ip, sizeof(ip));
+
+	return ((ip ^ (adr->port * 0x9E3779B1u)) * 2654435761u) >> 21;
+}
+
+static qboolean Proxy_Challenge_CompareAdr(const netadr_t* a, const netadr_t* b)
+{
+	return (qboolean)(a->type == b->type && !memcmp(a->ip, b->ip, sizeof(a->ip)) && a->port == b->port);
+}
+
+static void Proxy_Challenge_Insert(int challengeNum)
+{
+	int slot = Proxy_Challenge_Hash(&server.svs->challenges[challengeNum].adr);
+
+	while (challengeIndex.slots[slot])
+	{
+		slot = (slot + 1) & (CHALLENGE_HASH_SIZE - 1);
+	}
+
+	challengeIndex.slots[slot] = (short)(challengeNum + 1);
+}
+
+// Backward shift, the following entries of the probe sequence keep no hole before them
+static void Proxy_Challenge_Remove(int challengeNum)
+{
+	int slot = Proxy_Challenge_Hash(&server.svs->challenges[challengeNum].adr);
+	int next;
+
+	while (challengeIndex.slots[slot] != challengeNum + 1)
+	{
+		if (!challengeIndex.slots[slot])
+		{
+			return;
+		}
+
+		slot = (slot + 1) & (CHALLENGE_HASH_SIZE - 1);
+	}
+
+	for (next = (slot + 1) & (CHALLENGE_HASH_SIZE - 1); challengeIndex.slots[next]; next = (next + 1) & (CHALLENGE_HASH_SIZE - 1))
+	{
+		int home = Proxy_Challenge_Hash(&server.svs->challenges[challengeIndex.slots[next] - 1].adr);
+
+		// Its home is cyclically in (slot, next], it can't move to slot
+		if (((next - home) & (CHALLENGE_HASH_SIZE - 1)) < ((next - slot) & (CHALLENGE_HASH_SIZE - 1)))
+		{
+			continue;
+		}
+
+		challengeIndex.slots[slot] = challengeIndex.slots[next];
+		slot = next;
+	}
+
+	challengeIndex.slots[slot] = 0;
+}
+
+// The engine may have changed the array while the index was off
+static void Proxy_Challenge_Build(void)
+{
+	int i, oldestTime = 0x7fffffff;
+
+	memset(challengeIndex.slots, 0, sizeof(challengeIndex.slots));
+	challengeIndex.next = 0;
+
+	for (i = 0; i < MAX_CHALLENGES; i++)
+	{
+		challenge_t* challenge = &server.svs->challenges[i];
+
+		if (challenge->adr.type == NA_IP)
+		{
+			Proxy_Challenge_Insert(i);
+		}
+
+		if (challenge->time < oldestTime)
+		{
+			oldestTime = challenge->time;
+			challengeIndex.next = i;
+		}
+	}
+
+	challengeIndex.built = qtrue;
+}
+
+// The challenge of an address which isn't connected yet
+static challenge_t* Proxy_Challenge_Find(const netadr_t* adr)
+{
+	int slot;
+
+	for (slot = Proxy_Challenge_Hash(adr); challengeIndex.slots[slot]; slot = (slot + 1) & (CHALLENGE_HASH_SIZE - 1))
+	{
+		challenge_t* challenge = &server.svs->challenges[challengeIndex.slots[slot] - 1];
+
+		if (Proxy_Challenge_CompareAdr(&challenge->adr, adr) && !challenge->connected)
+		{
+			return challenge;
+		}
+	}
+
+	return NULL;
+}
+
+// Whether SV_DirectConnect may find a challenge for the address
+static qboolean Proxy_Challenge_IsKnown(const netadr_t* adr)
+{
+	int slot;
+
+	for (slot = Proxy_Challenge_Hash(adr); challengeIndex.slots[slot]; slot = (slot + 1) & (CHALLENGE_HASH_SIZE - 1))
+	{
+		if (Proxy_Challenge_CompareAdr(&server.svs->challenges[challengeIndex.slots[slot] - 1].adr, adr))
+		{
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+/*
+==================
+Proxy_Challenge_GetChallenge
+
+SV_GetChallenge, without its scans
+==================
+*/
+static void Proxy_Challenge_GetChallenge(int socket, const netadr_t* adr, const struct sockaddr* from, socklen_t fromLength)
+{
+	challenge_t* challenge = Proxy_Challenge_Find(adr);
+	char response[64];
+	int length;
+
+	if (!challenge)
+	{
+		// this is the first time this client has asked for a challenge
+		challenge = &server.svs->challenges[challengeIndex.next];
+
+		if (challenge->adr.type == NA_IP)
+		{
+			Proxy_Challenge_Remove(challengeIndex.next);
+		}
+
+		challenge->challenge = (int)(((unsigned)rand() << 16) ^ rand()) ^ server.svs->time;
+		challenge->adr = *adr;
+		challenge->firstTime = server.svs->time;
+		challenge->time = server.svs->time;
+		challenge->connected = qfalse;
+
+		Proxy_Challenge_Insert(challengeIndex.next);
+		challengeIndex.next = (challengeIndex.next + 1) % MAX_CHALLENGES;
+	}
+
+	challenge->pingTime = server.svs->time;
+
+	length = Com_sprintf(response, sizeof(response), "\xff\xff\xff\xff" "challengeResponse %i", challenge->challenge);
+	Proxy_Net_SendPacket(socket, response, length, from, fromLength);
+}
+
+/*
+==================
+Proxy_Challenge_Packet
+
+Returns qtrue when the packet was answered, the engine
+doesn't get it then
+==================
+*/
+qboolean Proxy_Challenge_Packet(int socket, const void* data, int length, const struct sockaddr* from, socklen_t fromLength)
+{
+	const char* text = (const char*)data + 4;
+	const char* end = (const char*)data + length;
+	const char* start;
+	qboolean connect;
+	netadr_t adr;
+
+	if (!proxy_sv_challengeHash.integer)
+	{
+		challengeIndex.built = qfalse;
+		return qfalse;
+	}
+
+	if (length < 4 || *(const int32_t*)data != -1 || from->sa_family != AF_INET)
+	{
+		return qfalse;
+	}
+
+	while (text < end && *text && *text <= ' ')
+	{
+		text++;
+	}
+
+	for (start = text; text < end && *text > ' '; text++)
+	{
+	}
+
+	connect = (qboolean)(text - start == 7 && !Q_stricmpn(start, "connect", 7));
+
+	if (!connect && (text - start != 12 || Q_stricmpn(start, "getchallenge", 12)))
+	{
+		return qfalse;
+	}
+
+	if (!challengeIndex.built)
+	{
+		Proxy_Challenge_Build();
+	}
+
+	memset(&adr, 0, sizeof(adr));
+	adr.type = NA_IP;
+	memcpy(adr.ip, &((const struct sockaddr_in*)from)->sin_addr, sizeof(adr.ip));
+	adr.port = ((const struct sockaddr_in*)from)->sin_port;
+
+	if (connect)
+	{
+		static const char response[] = "\xff\xff\xff\xff" "print\nNo or bad challenge for your address.\n";
+
+		if (Proxy_Challenge_IsKnown(&adr))
+		{
+			return qfalse;
+		}
+
+		Proxy_Net_SendPacket(socket, response, sizeof(response) - 1, from, fromLength);
+
+		return qtrue;
+	}
+
+	Proxy_Challenge_GetChallenge(socket, &adr, from, fromLength);
+
+	return qtrue;
+}
+
+#endif
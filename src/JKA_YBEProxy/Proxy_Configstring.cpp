@@ -0,0 +1,318 @@
+#include "Proxy_Header.hpp"
+#include "JKA_YBEProxy/EnginePatch/Proxy_EnginePatch.hpp"
+
+#include <vector>
+
+// ==================================================
+// Interned configstrings
+// --------------------------------------------------
+// The values the game gives to the engine for its
+// configstrings are interned in one arena with their hash,
+// a configstring is the index of its value there.
+// - the coalescing queue (proxy_sv_coalesceConfigstrings)
+//   knows a new value changes nothing by comparing hashes
+//   and lengths, without a GetConfigstring copy
+// - the gamestate writes the Huffman code of each value
+//   kept next to it instead of coding it byte by byte for
+//   every client, once the engine value is checked to be
+//   the interned one (it's interned when the engine set it)
+// The engine keeps its own copy of each configstring,
+// SV_SetConfigstring frees and copies them itself, so the
+// arena can't be its storage. An arena which holds more
+// dead bytes than live ones is compacted, it starts empty
+// at each map since the library is reloaded.
+// The values of the configstrings the proxy didn't see
+// are read from the engine the first time, serverinfo and
+// systeminfo are set by the engine itself so they are
+// always read from it.
+// ==================================================
+
+#define CONFIGSTRING_HASH_SIZE		4096	// power of 2, more than twice MAX_CONFIGSTRINGS
+#define CONFIGSTRING_MAX_VALUES		(CONFIGSTRING_HASH_SIZE / 2)
+#define CONFIGSTRING_MIN_COMPACT	0x10000	// dead bytes
+#define CONFIGSTRING_MAX_CODE_SIZE	(BIG_INFO_STRING * HUFFMAN_MAX_CODE_LENGTH / 8 + 8)
+
+typedef struct internedValue_s
+{
+	uint32_t	hash;
+	int			length;
+	int			offset;			// in the arena
+	int			refs;			// configstrings set to it
+	int			codeOffset;		// in the codes, -1 if not coded yet
+	int			codeBits;
+} internedValue_t;
+
+static struct Configstring_s {
+	std::vector<char>				arena;
+	std::vector<byte>				codes;
+	std::vector<internedValue_t>	values;
+	int								table[CONFIGSTRING_HASH_SIZE];	// value + 1, 0 if empty
+	int								current[MAX_CONFIGSTRINGS];		// value + 1, 0 if not known
+	size_t							deadBytes;
+	size_t							liveBytes;
+} configstring;
+
+static qboolean Proxy_Configstring_EngineOwned(int index)
+{
+	return (qboolean)(index == CS_SERVERINFO || index == CS_SYSTEMINFO);
+}
+
+static const char* Proxy_Configstring_Engine(int index, char* buffer, int bufferSize)
+{
+	if (proxy.isDefaultEngine)
+	{
+		return server.sv->configstrings[index] ? server.sv->configstrings[index] : "";
+	}
+
+	proxy.trap->GetConfigstring(index, buffer, bufferSize);
+
+	return buffer;
+}
+
+static int Proxy_Configstring_Intern(const char* value, int length, uint32_t hash)
+{
+	internedValue_t interned;
+	int slot = hash & (CONFIGSTRING_HASH_SIZE - 1);
+
+	while (configstring.table[slot])
+	{
+		internedValue_t* other = &configstring.values[configstring.table[slot] - 1];
+
+		if (other->hash == hash && other->length == length && !memcmp(&configstring.arena[other->offset], value, length))
+		{
+			return configstring.table[slot] - 1;
+		}
+
+		slot = (slot + 1) & (CONFIGSTRING_HASH_SIZE - 1);
+	}
+
+	interned.hash = hash;
+	interned.length = length;
+	interned.offset = (int)configstring.arena.size();
+	interned.refs = 0;
+	interned.codeOffset = -1;
+	interned.codeBits = 0;
+
+	configstring.arena.insert(configstring.arena.end(), value, value + length + 1);
+	configstring.values.push_back(interned);
+	configstring.deadBytes += length + 1;
+	configstring.table[slot] = (int)configstring.values.size();
+
+	return (int)configstring.values.size() - 1;
+}
+
+static void Proxy_Configstring_Reference(int index, int value)
+{
+	internedValue_t* interned;
+
+	if (configstring.current[index])
+	{
+		interned = &configstring.values[configstring.current[index] - 1];
+
+		if (!--interned->refs)
+		{
+			configstring.liveBytes -= interned->length + 1;
+			configstring.deadBytes += interned->length + 1;
+		}
+	}
+
+	configstring.current[index] = value + 1;
+
+	if (value < 0)
+	{
+		return;
+	}
+
+	interned = &configstring.values[value];
+
+	if (!interned->refs++)
+	{
+		configstring.deadBytes -= interned->length + 1;
+		configstring.liveBytes += interned->length + 1;
+	}
+}
+
+// Keeps the values still used, in a new arena, their codes are made again when needed
+static void Proxy_Configstring_Compact(void)
+{
+	std::vector<char> arena;
+	std::vector<internedValue_t> values;
+	int i;
+
+	arena.swap(configstring.arena);
+	values.swap(configstring.values);
+	configstring.arena.reserve(configstring.liveBytes);
+	configstring.codes.clear();
+	configstring.deadBytes = 0;
+	configstring.liveBytes = 0;
+	memset(configstring.table, 0, sizeof(configstring.table));
+
+	for (i = 0; i < MAX_CONFIGSTRINGS; i++)
+	{
+		internedValue_t* interned;
+
+		if (!configstring.current[i])
+		{
+			continue;
+		}
+
+		interned = &values[configstring.current[i] - 1];
+		configstring.current[i] = 0;
+		Proxy_Configstring_Reference(i, Proxy_Configstring_Intern(&arena[interned->offset], interned->length, interned->hash));
+	}
+}
+
+// The value the engine has for the configstring, NULL if it isn't known
+static internedValue_t* Proxy_Configstring_Current(int index)
+{
+	char buffer[BIG_INFO_STRING];
+
+	if (Proxy_Configstring_EngineOwned(index))
+	{
+		return NULL;
+	}
+
+	if (!configstring.current[index])
+	{
+		Proxy_Configstring_Set(index, Proxy_Configstring_Engine(index, buffer, sizeof(buffer)));
+	}
+
+	return &configstring.values[configstring.current[index] - 1];
+}
+
+void Proxy_Configstring_Set(int index, const char* value)
+{
+	int length;
+
+	if (index < 0 || index >= MAX_CONFIGSTRINGS || Proxy_Configstring_EngineOwned(index))
+	{
+		return;
+	}
+
+	if (!value)
+	{
+		value = "";
+	}
+
+	if (configstring.values.size() >= CONFIGSTRING_MAX_VALUES
+		|| (configstring.deadBytes > configstring.liveBytes && configstring.deadBytes > CONFIGSTRING_MIN_COMPACT))
+	{
+		Proxy_Configstring_Compact();
+	}
+
+	length = strlen(value);
+	Proxy_Configstring_Reference(index, Proxy_Configstring_Intern(value, length, Proxy_ServerCommand_Hash(value)));
+}
+
+// Returns qtrue when the engine already has this value for the configstring
+qboolean Proxy_Configstring_IsCurrent(int index, const char* value)
+{
+	char buffer[BIG_INFO_STRING];
+	internedValue_t* interned = Proxy_Configstring_Current(index);
+	int length;
+
+	if (!interned)
+	{
+		return (qboolean)!strcmp(Proxy_Configstring_Engine(index, buffer, sizeof(buffer)), value);
+	}
+
+	length = strlen(value);
+
+	return (qboolean)(interned->length == length
+		&& interned->hash == Proxy_ServerCommand_Hash(value)
+		&& !memcmp(&configstring.arena[interned->offset], value, length));
+}
+
+// The MSG_WriteBigString code of the value, made the first time
+static const byte* Proxy_Configstring_Code(internedValue_t* interned)
+{
+	static byte codeBuffer[CONFIGSTRING_MAX_CODE_SIZE];
+	msg_t codeMsg;
+
+	if (interned->codeOffset < 0)
+	{
+		memset(&codeMsg, 0, sizeof(codeMsg));
+		codeMsg.data = codeBuffer;
+		codeMsg.maxsize = sizeof(codeBuffer);
+
+		Proxy_MSG_HuffmanWriteBigString(&codeMsg, &configstring.arena[interned->offset]);
+
+		interned->codeOffset = (int)configstring.codes.size();
+		interned->codeBits = codeMsg.bit;
+		configstring.codes.insert(configstring.codes.end(), codeBuffer, codeBuffer + ((codeMsg.bit + 7) >> 3));
+	}
+
+	return &configstring.codes[interned->codeOffset];
+}
+
+/*
+==================
+Proxy_Configstring_WriteBigString
+
+MSG_WriteBigString of the engine value of a configstring of
+the gamestate, the index is a valid one
+==================
+*/
+void Proxy_Configstring_WriteBigString(msg_t* msg, int index)
+{
+	const char* value = server.sv->configstrings[index];
+	internedValue_t* interned;
+	const byte* code;
+	int numBits;
+
+	if (!value || !Proxy_MSG_NativeWrite(msg) || !proxyMsgHuffman.nativeBigString
+		|| !(interned = Proxy_Configstring_Current(index)))
+	{
+		Proxy_MSG_NativeWriteBigString(msg, value);
+
+		return;
+	}
+
+	// Set by the engine itself
+	if (strcmp(&configstring.arena[interned->offset], value))
+	{
+		Proxy_Configstring_Set(index, value);
+		interned = &configstring.values[configstring.current[index] - 1];
+	}
+
+	if (interned->length >= BIG_INFO_STRING)
+	{
+		Proxy_MSG_NativeWriteBigString(msg, value);
+
+		return;
+	}
+
+	code = Proxy_Configstring_Code(interned);
+	numBits = interned->codeBits;
+
+	// The cursize of the last byte written is the highest, none of them overflows if it doesn't
+	if (msg->maxsize - msg->cursize < 4 || msg->maxsize - (((msg->bit + numBits - 1) >> 3) + 1) < 4)
+	{
+		Proxy_MSG_HuffmanWriteBigString(msg, value);
+
+		return;
+	}
+
+	while (numBits > 0)
+	{
+		int chunk = numBits < 56 ? numBits : 56;
+		uint64_t bits = 0;
+		int i;
+
+		for (i = 0; i < (chunk + 7) >> 3; i++)
+		{
+			bits |= (uint64_t)code[i] << (i * 8);
+		}
+
+		if (chunk < 56)
+		{
+			bits &= ((uint64_t)1 << chunk) - 1;
+		}
+
+		Proxy_MSG_PutBits(msg, bits, chunk);
+		code += 7;
+		numBits -= chunk;
+	}
+
+	msg->cursize = (msg->bit >> 3) + 1;
+}
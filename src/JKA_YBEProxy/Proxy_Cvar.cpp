@@ -0,0 +1,70 @@
+#include "Proxy_Header.hpp"
+
+// ==================================================
+// Proxy cvars (see Proxy_XCvar.hpp)
+// ==================================================
+
+#define XCVAR_DECL
+	#include "Proxy_XCvar.hpp"
+#undef XCVAR_DECL
+
+typedef struct proxyCvarTable_s {
+	vmCvar_t*	vmCvar;
+	const char*	cvarName;
+	const char*	defaultString;
+	void		(*update)(void);
+	uint32_t	cvarFlags;
+} proxyCvarTable_t;
+
+static const proxyCvarTable_t proxyCvarTable[] = {
+	#define XCVAR_LIST
+		#include "Proxy_XCvar.hpp"
+	#undef XCVAR_LIST
+};
+static const size_t proxyCvarTableSize = ARRAY_LEN(proxyCvarTable);
+static qboolean proxyCvarsRegistered = qfalse;
+
+void Proxy_Cvar_Register(void)
+{
+	size_t i = 0;
+	const proxyCvarTable_t* cv = NULL;
+
+	for (i = 0, cv = proxyCvarTable; i < proxyCvarTableSize; i++, cv++)
+	{
+		proxy.trap->Cvar_Register(cv->vmCvar, cv->cvarName, cv->defaultString, cv->cvarFlags);
+
+		if (cv->update)
+		{
+			cv->update();
+		}
+	}
+
+	proxyCvarsRegistered = qtrue;
+}
+
+void Proxy_Cvar_Update(void)
+{
+	size_t i = 0;
+	const proxyCvarTable_t* cv = NULL;
+
+	// The handles are only valid once registered
+	if (!proxyCvarsRegistered)
+	{
+		return;
+	}
+
+	for (i = 0, cv = proxyCvarTable; i < proxyCvarTableSize; i++, cv++)
+	{
+		if (cv->vmCvar)
+		{
+			int modCount = cv->vmCvar->modificationCount;
+
+			proxy.trap->Cvar_Update(cv->vmCvar);
+
+			if (cv->vmCvar->modificationCount != modCount && cv->update)
+			{
+				cv->update();
+			}
+		}
+	}
+}
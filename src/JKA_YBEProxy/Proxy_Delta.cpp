@@ -0,0 +1,530 @@
+#include "Proxy_Header.hpp"
+
+#include <emmintrin.h>
+
+// ==================================================
+// SIMD state comparison
+// --------------------------------------------------
+// The netField tables of the engine are made of 32 bits
+// fields (ints and floats compared as ints), comparing
+// the states 16 bytes at a time gives the changed words
+// without walking the fields one by one.
+// ==================================================
+
+/*
+==================
+Proxy_Delta_CompareWords
+
+Compares numWords 32 bits words of from and to, sets the bit
+of every changed word in changedWords ((numWords + 31) / 32
+entries) and returns the number of changed words
+==================
+*/
+int Proxy_Delta_CompareWords(const void* from, const void* to, int numWords, uint32_t* changedWords)
+{
+	const int* fromWords = (const int*)from;
+	const int* toWords = (const int*)to;
+	int numChanged = 0;
+	int i = 0;
+
+	memset(changedWords, 0, ((numWords + 31) / 32) * sizeof(uint32_t));
+
+	for (; i + 4 <= numWords; i += 4)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(fromWords + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(toWords + i));
+		uint32_t changed = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))) & 0xF;
+
+		if (!changed)
+		{
+			continue;
+		}
+
+		// i is a multiple of 4, the 4 bits never straddle two entries
+		changedWords[i >> 5] |= changed << (i & 31);
+		numChanged += YBEProxy_PopCount(changed);
+	}
+
+	for (; i < numWords; i++)
+	{
+		if (fromWords[i] != toWords[i])
+		{
+			changedWords[i >> 5] |= 1U << (i & 31);
+			numChanged++;
+		}
+	}
+
+	return numChanged;
+}
+
+/*
+==================
+Proxy_Delta_Equal
+
+Same as !memcmp for 32 bits aligned sizes, stops at the first changed block
+==================
+*/
+qboolean Proxy_Delta_Equal(const void* from, const void* to, int size)
+{
+	const byte* fromBytes = (const byte*)from;
+	const byte* toBytes = (const byte*)to;
+	int i = 0;
+
+	for (; i + 64 <= size; i += 64)
+	{
+		__m128i a0 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(fromBytes + i)), _mm_loadu_si128((const __m128i*)(toBytes + i)));
+		__m128i a1 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(fromBytes + i + 16)), _mm_loadu_si128((const __m128i*)(toBytes + i + 16)));
+		__m128i a2 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(fromBytes + i + 32)), _mm_loadu_si128((const __m128i*)(toBytes + i + 32)));
+		__m128i a3 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(fromBytes + i + 48)), _mm_loadu_si128((const __m128i*)(toBytes + i + 48)));
+
+		if (_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(a0, a1), _mm_and_si128(a2, a3))) != 0xFFFF)
+		{
+			return qfalse;
+		}
+	}
+
+	for (; i + 16 <= size; i += 16)
+	{
+		__m128i a = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(fromBytes + i)), _mm_loadu_si128((const __m128i*)(toBytes + i)));
+
+		if (_mm_movemask_epi8(a) != 0xFFFF)
+		{
+			return qfalse;
+		}
+	}
+
+	return (qboolean)!memcmp(fromBytes + i, toBytes + i, size - i);
+}
+
+int Proxy_Delta_EntityStateChanges(const entityState_t* from, const entityState_t* to, uint32_t* changedWords)
+{
+	return Proxy_Delta_CompareWords(from, to, ENTITYSTATE_WORDS, changedWords);
+}
+
+// ==================================================
+// Dirty entities
+// --------------------------------------------------
+// Once per server frame, after the game module ran its
+// frame, the state of every linked entity is compared with
+// its shadow, the copy of its state of the last frame. The
+// dirty ones (changed, linked or unlinked) get the mask of
+// their changed words, their change time, a new shadow and
+// its hash, the others only cost one SIMD compare. The
+// shadow of the frame before is kept as well.
+// Using it:
+// - a delta from the previous state of an entity to its
+//   current one (the client got the last snapshot) takes
+//   the changed words of the frame (Proxy_Delta_Compare),
+// - the delta memo points to the shadows instead of
+//   copying the states, uses their hashes instead of hashing
+//   them for each client, and knows two shadows are equal
+//   without comparing them,
+// - priority culling doesn't leave out the entities which
+//   didn't change since they were last sent to the client,
+//   a delta snapshot costs nothing for them.
+// ==================================================
+
+// The states the memo refers to, >= 0 for the states of its pool
+#define DELTA_CURRENT_STATE(num)	(-1 - (num))
+#define DELTA_PREVIOUS_STATE(num)	(-1 - MAX_GENTITIES - (num))
+#define DELTA_UNTRACKED_STATE		(-1 - 2 * MAX_GENTITIES)
+
+static struct DirtyEntities_s {
+	entityState_t	current[MAX_GENTITIES];			// state of this frame
+	entityState_t	previous[MAX_GENTITIES];		// state of the frame before
+	uint32_t		currentHashes[MAX_GENTITIES];
+	uint32_t		previousHashes[MAX_GENTITIES];
+	uint32_t		currentLinked[MAX_GENTITIES / 32];
+	uint32_t		previousLinked[MAX_GENTITIES / 32];
+	uint32_t		dirty[MAX_GENTITIES / 32];
+	uint32_t		changedWords[MAX_GENTITIES][ENTITYSTATE_MASK_WORDS];	// previous to current, if dirty
+	int				numChanged[MAX_GENTITIES];
+	int				changeTimes[MAX_GENTITIES];
+} dirtyEntities;
+
+static uint32_t Proxy_Delta_HashState(const entityState_t* state)
+{
+	const uint32_t* words = (const uint32_t*)state;
+	uint32_t hash = 2166136261U;
+	int i;
+
+	for (i = 0; i < ENTITYSTATE_WORDS; i++)
+	{
+		hash = (hash ^ words[i]) * 16777619U;
+	}
+
+	return hash;
+}
+
+/*
+==================
+Proxy_Delta_UpdateDirtyEntities
+
+An entity is dirty when its entityState_t changed or when it
+got linked or unlinked since the last frame
+==================
+*/
+void Proxy_Delta_UpdateDirtyEntities(void)
+{
+	int numEntities = proxy.locatedGameData.num_entities;
+	int i;
+
+	if (numEntities > MAX_GENTITIES)
+	{
+		numEntities = MAX_GENTITIES;
+	}
+
+	for (i = 0; i < numEntities; i++)
+	{
+		sharedEntity_t* ent = Proxy_GetEntityByNum(i);
+		uint32_t bit = 1U << (i & 31);
+		qboolean wasLinked = (qboolean)((dirtyEntities.currentLinked[i >> 5] & bit) != 0);
+
+		// The shadow of the last frame becomes the previous one, it's
+		// already the same when the entity wasn't dirty in the last frame
+		if (dirtyEntities.dirty[i >> 5] & bit)
+		{
+			dirtyEntities.dirty[i >> 5] &= ~bit;
+
+			if (wasLinked)
+			{
+				dirtyEntities.previous[i] = dirtyEntities.current[i];
+				dirtyEntities.previousHashes[i] = dirtyEntities.currentHashes[i];
+				dirtyEntities.previousLinked[i >> 5] |= bit;
+			}
+			else
+			{
+				dirtyEntities.previousLinked[i >> 5] &= ~bit;
+			}
+		}
+
+		if (!ent->r.linked)
+		{
+			if (wasLinked)
+			{
+				dirtyEntities.currentLinked[i >> 5] &= ~bit;
+				dirtyEntities.dirty[i >> 5] |= bit;
+				dirtyEntities.changeTimes[i] = server.svs->time;
+			}
+
+			continue;
+		}
+
+		if (wasLinked && Proxy_Delta_Equal(&dirtyEntities.current[i], &ent->s, sizeof(entityState_t)))
+		{
+			continue;
+		}
+
+		if (wasLinked)
+		{
+			dirtyEntities.numChanged[i] = Proxy_Delta_EntityStateChanges(&dirtyEntities.current[i], &ent->s, dirtyEntities.changedWords[i]);
+		}
+		else
+		{
+			// No previous state to delta from
+			dirtyEntities.currentLinked[i >> 5] |= bit;
+		}
+
+		dirtyEntities.current[i] = ent->s;
+		dirtyEntities.currentHashes[i] = Proxy_Delta_HashState(&ent->s);
+		dirtyEntities.dirty[i >> 5] |= bit;
+		dirtyEntities.changeTimes[i] = server.svs->time;
+	}
+}
+
+// svs.time of the frame the entity last got dirty
+int Proxy_Delta_EntityChangeTime(int num)
+{
+	return dirtyEntities.changeTimes[num];
+}
+
+// Which shadow of its entity the state is equal to, if any
+static short Proxy_Delta_TrackedState(const entityState_t* state)
+{
+	int num = state->number;
+
+	if (num < 0 || num >= MAX_GENTITIES)
+	{
+		return DELTA_UNTRACKED_STATE;
+	}
+
+	if ((dirtyEntities.currentLinked[num >> 5] & (1U << (num & 31)))
+		&& Proxy_Delta_Equal(&dirtyEntities.current[num], state, sizeof(entityState_t)))
+	{
+		return DELTA_CURRENT_STATE(num);
+	}
+
+	if ((dirtyEntities.previousLinked[num >> 5] & (1U << (num & 31)))
+		&& Proxy_Delta_Equal(&dirtyEntities.previous[num], state, sizeof(entityState_t)))
+	{
+		return DELTA_PREVIOUS_STATE(num);
+	}
+
+	return DELTA_UNTRACKED_STATE;
+}
+
+/*
+==================
+Proxy_Delta_Compare
+
+The changed words of a delta and the shadows its states are
+equal to, returns the number of changed words
+==================
+*/
+int Proxy_Delta_Compare(const entityState_t* from, const entityState_t* to, entityDelta_t* delta)
+{
+	int num = to->number;
+
+	delta->from = Proxy_Delta_TrackedState(from);
+	delta->to = Proxy_Delta_TrackedState(to);
+
+	if (delta->to != DELTA_UNTRACKED_STATE && delta->from == delta->to)
+	{
+		memset(delta->changedWords, 0, sizeof(delta->changedWords));
+		delta->numChanged = 0;
+
+		return 0;
+	}
+
+	// From the last snapshot to this one, the changed words of the frame
+	if (delta->from == DELTA_PREVIOUS_STATE(num) && delta->to == DELTA_CURRENT_STATE(num)
+		&& (dirtyEntities.dirty[num >> 5] & (1U << (num & 31))))
+	{
+		memcpy(delta->changedWords, dirtyEntities.changedWords[num], sizeof(delta->changedWords));
+		delta->numChanged = dirtyEntities.numChanged[num];
+
+		return delta->numChanged;
+	}
+
+	delta->numChanged = Proxy_Delta_EntityStateChanges(from, to, delta->changedWords);
+
+	return delta->numChanged;
+}
+
+// ==================================================
+// Entity delta encodings memo (proxy_sv_deltaMemo)
+// --------------------------------------------------
+// During a frame most of the clients delta an entity from
+// the same previous state, the bits written for a (from,
+// to, force) are stored once and copied for the next
+// clients (see Proxy_MSG_WriteDeltaEntity).
+// The Huffman table of the messages is static so the bits
+// don't depend on where they are written.
+// The states of the entries are shared in a pool of the
+// frame, each distinct state is copied once whatever the
+// number of clients and entries using it, and the states
+// equal to a shadow of the dirty entities tracking aren't
+// copied at all, the entries point to the shadows (updated
+// once per frame, before the memo is reset).
+// Only the states of the memo are pooled, svs.snapshotEntities
+// isn't changed: the engine still copies the state of every
+// entity of every snapshot in it and keeps its size.
+// ==================================================
+
+#define DELTA_MEMO_HASH_SIZE	4096	// power of 2
+#define DELTA_MEMO_MAX_ENTRIES	2048
+#define DELTA_MEMO_BITS_SIZE	(DELTA_MEMO_MAX_ENTRIES * 64)
+#define DELTA_MEMO_MAX_STATES	DELTA_MEMO_MAX_ENTRIES
+
+typedef struct deltaMemoEntry_s
+{
+	uint32_t		hash;
+	qboolean		force;
+	short			from;			// see Proxy_Delta_MemoState
+	short			to;
+	int				bitsOffset;
+	int				numBits;
+} deltaMemoEntry_t;
+
+static struct DeltaMemo_s {
+	short				table[DELTA_MEMO_HASH_SIZE];	// entry + 1, 0 if empty
+	deltaMemoEntry_t	entries[DELTA_MEMO_MAX_ENTRIES];
+	int					numEntries;
+	byte				bits[DELTA_MEMO_BITS_SIZE];
+	int					bitsUsed;
+
+	// Pool of the states which aren't a shadow of their entity
+	short				stateTable[DELTA_MEMO_HASH_SIZE];	// state + 1, 0 if empty
+	uint32_t			stateHashes[DELTA_MEMO_MAX_STATES];
+	entityState_t		states[DELTA_MEMO_MAX_STATES];
+	int					numStates;
+} deltaMemo;
+
+void Proxy_Delta_ResetEncodings(void)
+{
+	// States are pooled before their entry is stored, the pool can be used without any entry
+	if (deltaMemo.numEntries)
+	{
+		memset(deltaMemo.table, 0, sizeof(deltaMemo.table));
+		deltaMemo.numEntries = 0;
+		deltaMemo.bitsUsed = 0;
+	}
+
+	if (deltaMemo.numStates)
+	{
+		memset(deltaMemo.stateTable, 0, sizeof(deltaMemo.stateTable));
+		deltaMemo.numStates = 0;
+	}
+}
+
+// A state of the pool when >= 0, a shadow of the entity otherwise
+static const entityState_t* Proxy_Delta_MemoState(short state)
+{
+	if (state >= 0)
+	{
+		return &deltaMemo.states[state];
+	}
+
+	if (state > DELTA_PREVIOUS_STATE(0))
+	{
+		return &dirtyEntities.current[-1 - state];
+	}
+
+	return &dirtyEntities.previous[-1 - MAX_GENTITIES - state];
+}
+
+/*
+==================
+Proxy_Delta_InternState
+
+Returns the shadow the state is equal to, or the state of the
+pool equal to it, added to it if needed.
+DELTA_MEMO_MAX_STATES when the pool is full.
+==================
+*/
+static short Proxy_Delta_InternState(const entityState_t* state, short tracked, uint32_t hash)
+{
+	int slot = hash & (DELTA_MEMO_HASH_SIZE - 1);
+
+	if (tracked != DELTA_UNTRACKED_STATE)
+	{
+		return tracked;
+	}
+
+	while (deltaMemo.stateTable[slot])
+	{
+		int other = deltaMemo.stateTable[slot] - 1;
+
+		if (deltaMemo.stateHashes[other] == hash && Proxy_Delta_Equal(&deltaMemo.states[other], state, sizeof(entityState_t)))
+		{
+			return (short)other;
+		}
+
+		slot = (slot + 1) & (DELTA_MEMO_HASH_SIZE - 1);
+	}
+
+	if (deltaMemo.numStates >= DELTA_MEMO_MAX_STATES)
+	{
+		return DELTA_MEMO_MAX_STATES;
+	}
+
+	deltaMemo.stateHashes[deltaMemo.numStates] = hash;
+	deltaMemo.states[deltaMemo.numStates] = *state;
+	deltaMemo.stateTable[slot] = (short)(deltaMemo.numStates + 1);
+
+	return (short)deltaMemo.numStates++;
+}
+
+// The hash of the shadow, computed when it got dirty
+static uint32_t Proxy_Delta_TrackedHash(const entityState_t* state, short tracked)
+{
+	if (tracked == DELTA_UNTRACKED_STATE)
+	{
+		return Proxy_Delta_HashState(state);
+	}
+
+	if (tracked > DELTA_PREVIOUS_STATE(0))
+	{
+		return dirtyEntities.currentHashes[-1 - tracked];
+	}
+
+	return dirtyEntities.previousHashes[-1 - MAX_GENTITIES - tracked];
+}
+
+// Also sets the hashes of the states of the delta
+uint32_t Proxy_Delta_HashEncoding(entityDelta_t* delta, const entityState_t* from, const entityState_t* to, qboolean force)
+{
+	uint32_t hash = 2166136261U ^ (uint32_t)force;
+
+	delta->fromHash = Proxy_Delta_TrackedHash(from, delta->from);
+	delta->toHash = Proxy_Delta_TrackedHash(to, delta->to);
+
+	hash = (hash ^ delta->fromHash) * 16777619U;
+	hash = (hash ^ delta->toHash) * 16777619U;
+
+	return hash ^ (hash >> 15);
+}
+
+// Equal if they're the same shadow, compared otherwise
+static qboolean Proxy_Delta_SameState(short memoState, short tracked, const entityState_t* state)
+{
+	if (memoState < 0 && tracked != DELTA_UNTRACKED_STATE)
+	{
+		return (qboolean)(memoState == tracked);
+	}
+
+	return Proxy_Delta_Equal(Proxy_Delta_MemoState(memoState), state, sizeof(entityState_t));
+}
+
+const byte* Proxy_Delta_FindEncoding(const entityDelta_t* delta, const entityState_t* from, const entityState_t* to, qboolean force, uint32_t hash, int* numBits)
+{
+	int slot = hash & (DELTA_MEMO_HASH_SIZE - 1);
+
+	while (deltaMemo.table[slot])
+	{
+		deltaMemoEntry_t* entry = &deltaMemo.entries[deltaMemo.table[slot] - 1];
+
+		if (entry->hash == hash && entry->force == force
+			&& Proxy_Delta_SameState(entry->to, delta->to, to)
+			&& Proxy_Delta_SameState(entry->from, delta->from, from))
+		{
+			*numBits = entry->numBits;
+
+			return deltaMemo.bits + entry->bitsOffset;
+		}
+
+		slot = (slot + 1) & (DELTA_MEMO_HASH_SIZE - 1);
+	}
+
+	return NULL;
+}
+
+// Returns where to copy the numBits bits of the encoding, NULL if the memo is full
+byte* Proxy_Delta_StoreEncoding(const entityDelta_t* delta, const entityState_t* from, const entityState_t* to, qboolean force, uint32_t hash, int numBits)
+{
+	int numBytes = (numBits + 7) >> 3;
+	int slot = hash & (DELTA_MEMO_HASH_SIZE - 1);
+	deltaMemoEntry_t* entry;
+	short fromState, toState;
+
+	if (deltaMemo.numEntries >= DELTA_MEMO_MAX_ENTRIES || deltaMemo.bitsUsed + numBytes > DELTA_MEMO_BITS_SIZE)
+	{
+		return NULL;
+	}
+
+	fromState = Proxy_Delta_InternState(from, delta->from, delta->fromHash);
+	toState = Proxy_Delta_InternState(to, delta->to, delta->toHash);
+
+	if (fromState == DELTA_MEMO_MAX_STATES || toState == DELTA_MEMO_MAX_STATES)
+	{
+		return NULL;
+	}
+
+	while (deltaMemo.table[slot])
+	{
+		slot = (slot + 1) & (DELTA_MEMO_HASH_SIZE - 1);
+	}
+
+	entry = &deltaMemo.entries[deltaMemo.numEntries++];
+	entry->hash = hash;
+	entry->force = force;
+	entry->from = fromState;
+	entry->to = toState;
+	entry->bitsOffset = deltaMemo.bitsUsed;
+	entry->numBits = numBits;
+
+	deltaMemo.table[slot] = (short)deltaMemo.numEntries;
+	deltaMemo.bitsUsed += numBytes;
+
+	return deltaMemo.bits + entry->bitsOffset;
+}
@@ -0,0 +1,534 @@
+#include "Proxy_Header.hpp"
+#include "JKA_YBEProxy/EnginePatch/Proxy_EnginePatch.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// ==================================================
+// Server side demos (proxy_record, proxy_stoprecord)
+// --------------------------------------------------
+// The messages sent to a recorded client are copied, as
+// they are before the netchan encoding, in a ring which
+// is written to the .dm_26 files by a writer thread, the
+// server frame never waits for the disk.
+// A demo starts with a gamestate built like the one of
+// SV_SendClientGameState followed by a non delta snapshot
+// (the delta of the client is dropped until one is sent),
+// this is done again if the ring was full and messages
+// were lost.
+// ==================================================
+
+#define DEMO_RING_SIZE		(8 * 1024 * 1024)
+#define DEMO_RECORD_ALIGN	16
+
+#define DEMO_RECORD_PAD		0	// skip to the start of the ring
+#define DEMO_RECORD_OPEN	1	// data is the path of the file
+#define DEMO_RECORD_MESSAGE	2
+#define DEMO_RECORD_CLOSE	3
+
+typedef struct demoRecord_s
+{
+	int		type;
+	int		clientNum;
+	int		sequence;
+	int		length;
+} demoRecord_t;
+
+typedef struct demoClient_s
+{
+	qboolean	recording;
+	qboolean	waitingKeyframe;
+	char		name[MAX_QPATH];
+} demoClient_t;
+
+static struct Demo_s {
+	// Server thread
+	demoClient_t				clients[MAX_CLIENTS];
+	int							numRecording;
+	qboolean					writerStarted;
+
+	// Writer thread
+	FILE*						files[MAX_CLIENTS];
+
+	// Shared, the server thread writes at head and the writer thread reads at tail
+	byte						ring[DEMO_RING_SIZE];
+	std::atomic<uint32_t>		head;
+	std::atomic<uint32_t>		tail;
+	std::atomic<bool>			quit;
+	std::atomic<uint32_t>		openFailed;		// bit of each client whose file couldn't be opened, printed by the server thread
+	std::mutex					wakeLock;
+	std::condition_variable		wake;
+	std::thread					writer;
+} demo;
+
+static void Proxy_Demo_WriterThread(void)
+{
+	for (;;)
+	{
+		uint32_t tail = demo.tail.load(std::memory_order_relaxed);
+		uint32_t head = demo.head.load(std::memory_order_acquire);
+
+		if (tail == head)
+		{
+			if (demo.quit.load())
+			{
+				break;
+			}
+
+			std::unique_lock<std::mutex> l(demo.wakeLock);
+
+			demo.wake.wait_for(l, std::chrono::milliseconds(100));
+
+			continue;
+		}
+
+		while (tail != head)
+		{
+			uint32_t offset = tail % DEMO_RING_SIZE;
+			demoRecord_t* record = (demoRecord_t*)(demo.ring + offset);
+			byte* data = (byte*)(record + 1);
+			FILE** file = &demo.files[record->clientNum];
+
+			if (record->type == DEMO_RECORD_PAD)
+			{
+				tail += DEMO_RING_SIZE - offset;
+
+				continue;
+			}
+
+			switch (record->type)
+			{
+				case DEMO_RECORD_OPEN:
+					if (*file)
+					{
+						fclose(*file);
+					}
+
+					*file = fopen((const char*)data, "wb");
+
+					// Com_Printf isn't thread safe, Proxy_Demo_RunFrame prints it
+					if (!*file)
+					{
+						demo.openFailed.fetch_or(1U << record->clientNum);
+					}
+					break;
+				case DEMO_RECORD_MESSAGE:
+					if (*file)
+					{
+						int header[2] = { LittleLong(record->sequence), LittleLong(record->length) };
+
+						fwrite(header, sizeof(header), 1, *file);
+						fwrite(data, record->length, 1, *file);
+					}
+					break;
+				case DEMO_RECORD_CLOSE:
+					if (*file)
+					{
+						// Same end of demo as the client
+						int header[2] = { -1, -1 };
+
+						fwrite(header, sizeof(header), 1, *file);
+						fclose(*file);
+						*file = NULL;
+					}
+					break;
+				default:
+					break;
+			}
+
+			tail += PAD(sizeof(demoRecord_t) + record->length, DEMO_RECORD_ALIGN);
+		}
+
+		demo.tail.store(tail, std::memory_order_release);
+	}
+}
+
+// Returns qfalse if the ring is full
+static qboolean Proxy_Demo_PushRecord(int type, int clientNum, int sequence, const void* data, int length)
+{
+	uint32_t head = demo.head.load(std::memory_order_relaxed);
+	uint32_t used = head - demo.tail.load(std::memory_order_acquire);
+	uint32_t offset = head % DEMO_RING_SIZE;
+	uint32_t size = PAD(sizeof(demoRecord_t) + length, DEMO_RECORD_ALIGN);
+	uint32_t skip = (offset + size > DEMO_RING_SIZE) ? DEMO_RING_SIZE - offset : 0;
+	demoRecord_t* record;
+
+	if (used + skip + size > DEMO_RING_SIZE)
+	{
+		return qfalse;
+	}
+
+	if (skip)
+	{
+		record = (demoRecord_t*)(demo.ring + offset);
+		record->type = DEMO_RECORD_PAD;
+		head += skip;
+		offset = 0;
+	}
+
+	record = (demoRecord_t*)(demo.ring + offset);
+	record->type = type;
+	record->clientNum = clientNum;
+	record->sequence = sequence;
+	record->length = length;
+
+	if (length)
+	{
+		memcpy(record + 1, data, length);
+	}
+
+	demo.head.store(head + size, std::memory_order_release);
+
+	return qtrue;
+}
+
+// Same as SV_SendClientGameState without touching the client
+static void Proxy_Demo_WriteGamestate(client_t* client, msg_t* msg)
+{
+	entityState_t nullstate;
+	int i;
+
+	Proxy_MSG_NativeWriteLong(msg, client->lastClientCommand);
+	Proxy_MSG_NativeWriteByte(msg, svc_gamestate);
+	Proxy_MSG_NativeWriteLong(msg, client->reliableSequence);
+
+	for (i = 0; i < MAX_CONFIGSTRINGS; i++)
+	{
+		if (server.sv->configstrings[i][0])
+		{
+			Proxy_MSG_NativeWriteByte(msg, svc_configstring);
+			Proxy_MSG_NativeWriteShort(msg, i);
+			Proxy_Configstring_WriteBigString(msg, i);
+		}
+	}
+
+	Com_Memset(&nullstate, 0, sizeof(nullstate));
+
+	for (i = 0; i < MAX_GENTITIES; i++)
+	{
+		entityState_t* base = &server.sv->svEntities[i].baseline;
+
+		if (!base->number)
+		{
+			continue;
+		}
+
+		Proxy_MSG_NativeWriteByte(msg, svc_baseline);
+		Proxy_MSG_WriteDeltaEntity(msg, &nullstate, base, qtrue);
+	}
+
+	Proxy_MSG_NativeWriteByte(msg, svc_EOF);
+	Proxy_MSG_NativeWriteLong(msg, client - server.svs->clients);
+	Proxy_MSG_NativeWriteLong(msg, server.sv->checksumFeed);
+
+	// For old RMG system.
+	Proxy_MSG_NativeWriteShort(msg, 0);
+}
+
+static void Proxy_Demo_Start(int clientNum, const char* name)
+{
+	demoClient_t* demoClient = &demo.clients[clientNum];
+	char homePath[MAX_OSPATH];
+	char game[MAX_QPATH];
+	char path[MAX_OSPATH];
+	fileHandle_t f;
+
+	if (demoClient->recording)
+	{
+		proxy.trap->Print("Already recording client %i to %s\n", clientNum, demoClient->name);
+
+		return;
+	}
+
+	Com_sprintf(demoClient->name, sizeof(demoClient->name), "demos/%s.dm_26", name);
+
+	// Let the engine create the folders
+	proxy.trap->FS_Open(demoClient->name, &f, FS_WRITE);
+
+	if (!f)
+	{
+		proxy.trap->Print("Can't create %s\n", demoClient->name);
+
+		return;
+	}
+
+	proxy.trap->FS_Close(f);
+
+	proxy.trap->Cvar_VariableStringBuffer("fs_homepath", homePath, sizeof(homePath));
+	proxy.trap->Cvar_VariableStringBuffer(FS_GAME_CVAR, game, sizeof(game));
+
+	if (!game[0])
+	{
+		Q_strncpyz(game, DEFAULT_BASE_GAME_FOLDER_NAME, sizeof(game));
+	}
+
+	if (homePath[0])
+	{
+		Com_sprintf(path, sizeof(path), "%s/%s/%s", homePath, game, demoClient->name);
+	}
+	else
+	{
+		Com_sprintf(path, sizeof(path), "%s/%s", game, demoClient->name);
+	}
+
+	if (!demo.writerStarted)
+	{
+		demo.quit = false;
+		demo.writer = std::thread(Proxy_Demo_WriterThread);
+		demo.writerStarted = qtrue;
+	}
+
+	if (!Proxy_Demo_PushRecord(DEMO_RECORD_OPEN, clientNum, 0, path, strlen(path) + 1))
+	{
+		proxy.trap->Print("Demo buffer full, try again\n");
+
+		return;
+	}
+
+	demoClient->recording = qtrue;
+	demoClient->waitingKeyframe = qtrue;
+	demo.numRecording++;
+
+	proxy.trap->Print("Recording client %i to %s\n", clientNum, demoClient->name);
+}
+
+static void Proxy_Demo_Stop(int clientNum)
+{
+	demoClient_t* demoClient = &demo.clients[clientNum];
+
+	if (!demoClient->recording)
+	{
+		return;
+	}
+
+	// Retried on the next frames if the ring is full
+	if (!Proxy_Demo_PushRecord(DEMO_RECORD_CLOSE, clientNum, 0, NULL, 0))
+	{
+		return;
+	}
+
+	demoClient->recording = qfalse;
+	demo.numRecording--;
+
+	proxy.trap->Print("Stopped recording client %i to %s\n", clientNum, demoClient->name);
+}
+
+/*
+==================
+Proxy_Demo_ConsoleCommand
+
+proxy_record <clientNum> [name]
+proxy_stoprecord <clientNum|all>
+==================
+*/
+qboolean Proxy_Demo_ConsoleCommand(void)
+{
+	char cmd[MAX_TOKEN_CHARS];
+	char arg1[MAX_TOKEN_CHARS];
+	char arg2[MAX_TOKEN_CHARS];
+	int clientNum;
+
+	proxy.trap->Argv(0, cmd, sizeof(cmd));
+
+	if (Q_stricmp(cmd, "proxy_record") && Q_stricmp(cmd, "proxy_stoprecord"))
+	{
+		return qfalse;
+	}
+
+	if (!proxy.isDefaultEngine)
+	{
+		proxy.trap->Print("%s is only available with the original engine\n", cmd);
+
+		return qtrue;
+	}
+
+	if (proxy.trap->Argc() < 2)
+	{
+		proxy.trap->Print("usage: %s\n", !Q_stricmp(cmd, "proxy_record") ? "proxy_record <clientNum> [name]" : "proxy_stoprecord <clientNum|all>");
+
+		return qtrue;
+	}
+
+	proxy.trap->Argv(1, arg1, sizeof(arg1));
+	proxy.trap->Argv(2, arg2, sizeof(arg2));
+
+	if (!Q_stricmp(cmd, "proxy_stoprecord") && !Q_stricmp(arg1, "all"))
+	{
+		for (clientNum = 0; clientNum < MAX_CLIENTS; clientNum++)
+		{
+			Proxy_Demo_Stop(clientNum);
+		}
+
+		return qtrue;
+	}
+
+	clientNum = atoi(arg1);
+
+	if (clientNum < 0 || clientNum >= server.cvars.sv_maxclients->integer || server.svs->clients[clientNum].state < CS_CONNECTED)
+	{
+		proxy.trap->Print("Bad client slot: %s\n", arg1);
+
+		return qtrue;
+	}
+
+	if (!Q_stricmp(cmd, "proxy_stoprecord"))
+	{
+		Proxy_Demo_Stop(clientNum);
+
+		return qtrue;
+	}
+
+	if (!arg2[0])
+	{
+		qtime_t now;
+		char* c;
+
+		proxy.trap->RealTime(&now);
+
+		Com_sprintf(arg2, sizeof(arg2), "%s_%04i-%02i-%02i_%02i-%02i-%02i", proxy.clientData[clientNum].cleanName,
+			1900 + now.tm_year, 1 + now.tm_mon, now.tm_mday, now.tm_hour, now.tm_min, now.tm_sec);
+
+		for (c = arg2; *c; c++)
+		{
+			if (!isalnum((unsigned char)*c) && *c != '-' && *c != '_')
+			{
+				*c = '_';
+			}
+		}
+	}
+
+	Proxy_Demo_Start(clientNum, arg2);
+
+	return qtrue;
+}
+
+/*
+==================
+Proxy_Demo_RunFrame
+
+Drops the delta of the clients waiting for their first
+snapshot so the next one sent is a non delta snapshot
+==================
+*/
+void Proxy_Demo_RunFrame(void)
+{
+	uint32_t openFailed = demo.openFailed.exchange(0);
+	int i;
+
+	for (i = 0; openFailed; i++, openFailed >>= 1)
+	{
+		if (openFailed & 1)
+		{
+			proxy.trap->Print("Can't open %s\n", demo.clients[i].name);
+			Proxy_Demo_Stop(i);
+		}
+	}
+
+	if (!demo.numRecording)
+	{
+		return;
+	}
+
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		client_t* client = &server.svs->clients[i];
+
+		if (!demo.clients[i].recording)
+		{
+			continue;
+		}
+
+		if (i >= server.cvars.sv_maxclients->integer || client->state < CS_CONNECTED)
+		{
+			Proxy_Demo_Stop(i);
+
+			continue;
+		}
+
+		if (demo.clients[i].waitingKeyframe)
+		{
+			client->deltaMessage = -1;
+		}
+	}
+
+	demo.wake.notify_one();
+}
+
+/*
+==================
+Proxy_Demo_Message
+
+Called from Proxy_SV_SendMessageToClient before the
+netchan encoding
+==================
+*/
+void Proxy_Demo_Message(client_t* client, msg_t* msg)
+{
+	int clientNum = client - server.svs->clients;
+	demoClient_t* demoClient = &demo.clients[clientNum];
+	int sequence = client->netchan.outgoingSequence;
+
+	if (!demoClient->recording)
+	{
+		return;
+	}
+
+	if (demoClient->waitingKeyframe)
+	{
+		byte msgBuffer[MAX_MSGLEN];
+		msg_t gamestate;
+
+		// A real gamestate does the job
+		if (client->gamestateMessageNum != sequence)
+		{
+			if (client->state != CS_ACTIVE || client->deltaMessage > 0)
+			{
+				return;
+			}
+
+			server.common.functions.MSG_Init(&gamestate, msgBuffer, sizeof(msgBuffer));
+			Proxy_Demo_WriteGamestate(client, &gamestate);
+
+			if (!Proxy_Demo_PushRecord(DEMO_RECORD_MESSAGE, clientNum, sequence - 1, gamestate.data, gamestate.cursize))
+			{
+				return;
+			}
+		}
+
+		demoClient->waitingKeyframe = qfalse;
+	}
+
+	if (!Proxy_Demo_PushRecord(DEMO_RECORD_MESSAGE, clientNum, sequence, msg->data, msg->cursize))
+	{
+		demoClient->waitingKeyframe = qtrue;
+	}
+}
+
+// Closes the demos and waits for the writer thread
+void Proxy_Demo_Shutdown(void)
+{
+	int i;
+
+	if (!demo.writerStarted)
+	{
+		return;
+	}
+
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		while (demo.clients[i].recording)
+		{
+			demo.wake.notify_one();
+			Proxy_Demo_Stop(i);
+			std::this_thread::yield();
+		}
+	}
+
+	demo.quit = true;
+	demo.wake.notify_one();
+	demo.writer.join();
+
+	demo.writerStarted = qfalse;
+}
@@ -0,0 +1,176 @@
+#include "Proxy_Header.hpp"
+
+#include <atomic>
+#include <vector>
+
+// ==================================================
+// Connectionless packet filter (proxy_sv_filter...)
+// --------------------------------------------------
+// Checked first for every connectionless packet, before
+// the engine or the other handlers of Proxy_Net parse it:
+// - the address against the rules of proxy_sv_filterFile,
+//   "ban <ip>[/bits]" and "allow <ip>[/bits]" lines compiled
+//   into a binary trie where the longest prefix wins
+//   (Proxy_FilterRules.cpp), an allowed address skips the
+//   other checks
+// - proxy_sv_filterRate connectionless packets per second
+//   for an address
+// - the command, only getstatus, getinfo, getchallenge,
+//   connect and rcon get through
+// The rules are loaded at startup and by proxy_reloadfilter,
+// a new trie replaces the old one once it's complete.
+// ==================================================
+
+#define FILTER_BUCKETS			4096	// power of 2
+#define FILTER_MAX_FILE_SIZE	(1024 * 1024)
+
+static const char* filterCommands[] = { "getstatus", "getinfo", "getchallenge", "connect", "rcon" };
+
+static struct Filter_s {
+	std::atomic<filterRules_t*>	rules;
+	proxyRateBucket_t			buckets[FILTER_BUCKETS];
+} filter;
+
+// Update function of proxy_sv_filterFile and proxy_reloadfilter
+void Proxy_Filter_Load(void)
+{
+	filterRules_t* rules;
+	fileHandle_t f;
+	int length, lineNum = 1;
+
+	// The packets only go through the proxy with the original engine
+	if (!proxy.isDefaultEngine)
+	{
+		return;
+	}
+
+	rules = Proxy_FilterRules_New();
+
+	if (proxy_sv_filterFile.string[0])
+	{
+		length = proxy.trap->FS_Open(proxy_sv_filterFile.string, &f, FS_READ);
+
+		if (length < 0 || !f)
+		{
+			proxy.trap->Print("----- Proxy: Filter: can't open %s\n", proxy_sv_filterFile.string);
+		}
+		else if (length > FILTER_MAX_FILE_SIZE)
+		{
+			proxy.trap->Print("----- Proxy: Filter: %s is too big\n", proxy_sv_filterFile.string);
+			proxy.trap->FS_Close(f);
+		}
+		else
+		{
+			std::vector<char> text(length + 1);
+			char* line;
+			char* next;
+
+			proxy.trap->FS_Read(text.data(), length, f);
+			proxy.trap->FS_Close(f);
+			text[length] = '\0';
+
+			for (line = text.data(); line; line = next, lineNum++)
+			{
+				next = strchr(line, '\n');
+
+				if (next)
+				{
+					*next++ = '\0';
+				}
+
+				if (!Proxy_FilterRules_ParseLine(rules, line))
+				{
+					proxy.trap->Print("----- Proxy: Filter: %s:%d is not a rule\n", proxy_sv_filterFile.string, lineNum);
+				}
+			}
+
+			proxy.trap->Print("----- Proxy: Filter: %d rules loaded from %s\n", Proxy_FilterRules_Count(rules), proxy_sv_filterFile.string);
+		}
+	}
+
+	Proxy_FilterRules_Free(filter.rules.exchange(rules, std::memory_order_acq_rel));
+}
+
+void Proxy_Filter_Shutdown(void)
+{
+	Proxy_FilterRules_Free(filter.rules.exchange(NULL, std::memory_order_acq_rel));
+}
+
+qboolean Proxy_Filter_ConsoleCommand(void)
+{
+	char cmd[MAX_TOKEN_CHARS];
+
+	proxy.trap->Argv(0, cmd, sizeof(cmd));
+
+	if (Q_stricmp(cmd, "proxy_reloadfilter"))
+	{
+		return qfalse;
+	}
+
+	Proxy_Filter_Load();
+
+	return qtrue;
+}
+
+#ifndef _MSC_VER
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*
+==================
+Proxy_Filter_Packet
+
+Returns qtrue when the packet is dropped
+==================
+*/
+qboolean Proxy_Filter_Packet(const void* data, int length, const struct sockaddr* from)
+{
+	const char* text = (const char*)data + 4;
+	const char* end = (const char*)data + length;
+	const char* start;
+	const filterRules_t* rules;
+	uint32_t ip;
+	size_t i;
+
+	if (!proxy_sv_filter.integer || length < 4 || *(const int32_t*)data != -1 || from->sa_family != AF_INET)
+	{
+		return qfalse;
+	}
+
+	ip = ntohl(((const struct sockaddr_in*)from)->sin_addr.s_addr);
+	rules = filter.rules.load(std::memory_order_acquire);
+
+	switch (rules ? Proxy_FilterRules_Match(rules, ip) : FILTER_NONE)
+	{
+		case FILTER_ALLOW:	return qfalse;
+		case FILTER_BAN:	return qtrue;
+		default:			break;
+	}
+
+	if (proxy_sv_filterRate.integer > 0 && !Proxy_Net_RateAllow(filter.buckets, FILTER_BUCKETS, ip, proxy_sv_filterRate.integer))
+	{
+		return qtrue;
+	}
+
+	while (text < end && *text && *text <= ' ')
+	{
+		text++;
+	}
+
+	for (start = text; text < end && *text > ' '; text++)
+	{
+	}
+
+	for (i = 0; i < ARRAY_LEN(filterCommands); i++)
+	{
+		if (text - start == (int)strlen(filterCommands[i]) && !Q_stricmpn(start, filterCommands[i], text - start))
+		{
+			return qfalse;
+		}
+	}
+
+	return qtrue;
+}
+
+#endif
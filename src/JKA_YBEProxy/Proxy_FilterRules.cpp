@@ -0,0 +1,149 @@
+#include "Proxy_Header.hpp"
+
+#include <vector>
+
+// ==================================================
+// Connectionless packet filter rules
+// --------------------------------------------------
+// The "ban <ip>[/bits]" and "allow <ip>[/bits]" lines of
+// proxy_sv_filterFile compiled into a binary trie, the
+// longest prefix matching an address gives its rule.
+// Kept apart from Proxy_Filter.cpp, which loads the file
+// and filters the packets, so Proxy_FilterTest can check
+// the parser and the trie without the engine.
+// ==================================================
+
+typedef struct filterNode_s
+{
+	int				children[2];	// 0 is none, the root is never a child
+	filterRule_t	rule;			// of the prefix ending here
+} filterNode_t;
+
+struct filterRules_s
+{
+	std::vector<filterNode_t>	nodes;
+	int							numRules;
+};
+
+filterRules_t* Proxy_FilterRules_New(void)
+{
+	filterRules_t* rules = new filterRules_t;
+	filterNode_t root = { { 0, 0 }, FILTER_NONE };
+
+	rules->nodes.push_back(root);
+	rules->numRules = 0;
+
+	return rules;
+}
+
+void Proxy_FilterRules_Free(filterRules_t* rules)
+{
+	delete rules;
+}
+
+int Proxy_FilterRules_Count(const filterRules_t* rules)
+{
+	return rules->numRules;
+}
+
+static void Proxy_FilterRules_Add(filterRules_t* rules, uint32_t ip, int bits, filterRule_t rule)
+{
+	int node = 0, i;
+
+	for (i = 0; i < bits; i++)
+	{
+		int bit = (ip >> (31 - i)) & 1;
+
+		if (!rules->nodes[node].children[bit])
+		{
+			filterNode_t child = { { 0, 0 }, FILTER_NONE };
+
+			rules->nodes.push_back(child);
+			rules->nodes[node].children[bit] = (int)rules->nodes.size() - 1;
+		}
+
+		node = rules->nodes[node].children[bit];
+	}
+
+	rules->nodes[node].rule = rule;
+	rules->numRules++;
+}
+
+filterRule_t Proxy_FilterRules_Match(const filterRules_t* rules, uint32_t ip)
+{
+	filterRule_t rule = FILTER_NONE;
+	int node = 0, bit;
+
+	for (bit = 31; ; bit--)
+	{
+		if (rules->nodes[node].rule != FILTER_NONE)
+		{
+			rule = rules->nodes[node].rule;
+		}
+
+		if (bit < 0)
+		{
+			break;
+		}
+
+		node = rules->nodes[node].children[(ip >> bit) & 1];
+
+		if (!node)
+		{
+			break;
+		}
+	}
+
+	return rule;
+}
+
+// "ban 1.2.3.0/24", "allow 1.2.3.4", # or // comments
+qboolean Proxy_FilterRules_ParseLine(filterRules_t* rules, const char* line)
+{
+	char action[16];
+	unsigned int a, b, c, d;
+	int bits = 32, consumed = 0;
+	filterRule_t rule;
+
+	while (*line && *line <= ' ')
+	{
+		line++;
+	}
+
+	if (!*line || *line == '#' || (line[0] == '/' && line[1] == '/'))
+	{
+		return qtrue;
+	}
+
+	if (sscanf(line, "%15s %u.%u.%u.%u%n", action, &a, &b, &c, &d, &consumed) != 5)
+	{
+		return qfalse;
+	}
+
+	if (line[consumed] == '/' && sscanf(line + consumed + 1, "%d", &bits) != 1)
+	{
+		return qfalse;
+	}
+
+	if (!Q_stricmp(action, "ban"))
+	{
+		rule = FILTER_BAN;
+	}
+	else if (!Q_stricmp(action, "allow"))
+	{
+		rule = FILTER_ALLOW;
+	}
+	else
+	{
+		return qfalse;
+	}
+
+	if (a > 255 || b > 255 || c > 255 || d > 255 || bits < 0 || bits > 32)
+	{
+		return qfalse;
+	}
+
+	Proxy_FilterRules_Add(rules, (a << 24) | (b << 16) | (c << 8) | d, bits, rule);
+
+	return qtrue;
+}
@@ -18,9 +18,37 @@
 	#define YBEProxy_CloseLibrary(a) FreeLibrary((HMODULE)a)
 	#define YBEProxy_GetFunctionAddress(a, b) GetProcAddress((HMODULE)a, b)
 
+	#include <intrin.h>
+	#pragma intrinsic(_ReturnAddress)
+
+	#define YBEProxy_ReturnAddress() _ReturnAddress()
+
+	// Index of the lowest set bit, bits isn't 0
+	static __inline int YBEProxy_LowestBit(unsigned int bits)
+	{
+		unsigned long index;
+
+		_BitScanForward(&index, bits);
+
+		return (int)index;
+	}
+
+	static __inline int YBEProxy_PopCount(unsigned int bits)
+	{
+		int count = 0;
+
+		for (; bits; bits &= bits - 1)
+		{
+			count++;
+		}
+
+		return count;
+	}
+
 	#define ORIGINAL_ENGINE_VERSION "(internal)JAmp: v1.0.1.0 win-x86 Oct 30 2003"
 #else
 	#include <dlfcn.h>
+	#include <sys/socket.h>
 
 	#define PROXY_LIBRARY_EXT "so"
 
@@ -28,6 +56,11 @@
 	#define YBEProxy_CloseLibrary(a) dlclose(a)
 	#define YBEProxy_GetFunctionAddress(a, b) dlsym(a, b)
 
+	#define YBEProxy_ReturnAddress() __builtin_return_address(0)
+
+	#define YBEProxy_LowestBit(a) __builtin_ctz(a)
+	#define YBEProxy_PopCount(a) __builtin_popcount(a)
+
 	#define ORIGINAL_ENGINE_VERSION "JAmp: v1.0.1.1 linux-i386 Nov 10 2003"
 #endif
 
@@ -57,6 +90,10 @@
 #define YBEPROXY_VERSION "0.5.2 Beta"
 #define YBEPROXY_BY_AUTHOR "by Yberion"
 
+// entityState_t is only made of 32 bits fields
+#define ENTITYSTATE_WORDS (int)(sizeof(entityState_t) / sizeof(int))
+#define ENTITYSTATE_MASK_WORDS ((ENTITYSTATE_WORDS + 31) / 32)
+
 // ==================================================
 // TYPEDEF
 // ==================================================
@@ -85,6 +122,54 @@ typedef struct ucmdStat_s
 
 #define CMD_MASK 1024
 
+// A delta between two entity states (Proxy_Delta_Compare)
+typedef struct entityDelta_s
+{
+	short		from;			// shadow of the dirty entities tracking the state is equal to
+	short		to;
+	uint32_t	fromHash;		// set by Proxy_Delta_HashEncoding
+	uint32_t	toHash;
+	int			numChanged;
+	uint32_t	changedWords[ENTITYSTATE_MASK_WORDS];
+} entityDelta_t;
+
+// Entities visible from one (cluster, area), filled by the first
+// client snapshot built from there and shared with the next ones
+typedef struct snapshotViewCache_s
+{
+	int			cluster;
+	int			area;
+	qboolean	populated;
+	uint32_t	visibleEntities[MAX_GENTITIES / 32];
+} snapshotViewCache_t;
+
+// Entities visible from the exact view of a client (follow spectators
+// of the same player), valid whatever the cull distance or portals
+typedef struct snapshotViewGroup_s
+{
+	int			clientNum;
+	qboolean	populated;
+	uint32_t	visibleEntities[MAX_GENTITIES / 32];
+} snapshotViewGroup_t;
+
+// Token bucket of an address for the connectionless packet limits (see Proxy_Net_RateAllow)
+typedef struct proxyRateBucket_s
+{
+	uint32_t	address;
+	int			tokens;		// 1000 per packet
+	int			time;
+} proxyRateBucket_t;
+
+typedef enum
+{
+	FILTER_NONE,
+	FILTER_BAN,
+	FILTER_ALLOW
+} filterRule_t;
+
+// Compiled rules of proxy_sv_filterFile (see Proxy_FilterRules.cpp)
+typedef struct filterRules_s filterRules_t;
+
 typedef struct Proxy_s {
 	void					*jampgameHandle;
 
@@ -125,7 +210,45 @@ typedef struct Proxy_s {
 
 		ucmdStat_t			cmdStats[CMD_MASK];
 		int					cmdIndex;
+
+		int					lastSnapshotTime[MAX_GENTITIES];	// svs.time of the last snapshot with this entity
 	} clientData[MAX_CLIENTS];
+
+	struct SnapshotData_s {
+		void*				snapshotCallSite;		// SV_SvEntityForGentity call from SV_AddEntitiesVisibleFromPoint
+		void*				candidateCallSite;
+		int					lastSnapshotCounter;
+
+		// Order in which SV_SendClientMessages is going to build the snapshots
+		int					frameSnapshotCounter;
+		int					scheduledClients[MAX_CLIENTS];
+		int					numScheduledClients;
+		qboolean			scheduleChecked;
+		int					currentClientNum;		// client of the snapshot being built, -1 if unknown
+
+		qboolean			serverCullEnabled;		// the game asked for a distance cull (SetServerCull)
+
+		qboolean			viewCacheEnabled;
+		int					viewCacheTime;
+		snapshotViewCache_t	viewCaches[MAX_CLIENTS];
+		int					numViewCaches;
+		int					currentViewCache;		// used to reject entities, -1 if none
+		int					populateViewCache;		// filled by the snapshot being built, -1 if none
+		int					populateSnapshotCounter;
+
+		snapshotViewGroup_t	viewGroups[MAX_CLIENTS];
+		int					numViewGroups;
+		int					currentViewGroup;		// used to reject entities, -1 if none
+		int					populateViewGroup;		// filled by the snapshot being built, -1 if none
+
+		qboolean			hideEntities;
+		uint32_t			hiddenEntities[MAX_GENTITIES / 32];	// low priority entities skipped for the current client
+
+		svEntity_t			skippedEntity;
+
+		int					botSnapshotTime[MAX_CLIENTS];	// svs.time of the last snapshot built for the bot
+		qboolean			botSnapshotUnread[MAX_CLIENTS];	// not read by the game yet
+	} snapshotData;
 } Proxy_t;
 
 // ==================================================
@@ -138,18 +261,91 @@ extern Proxy_t proxy;
 // FUNCTION
 // ==================================================
 
+// ------------------------
+// Proxy_Challenge
+// ------------------------
+
+#ifndef _MSC_VER
+qboolean Proxy_Challenge_Packet(int socket, const void* data, int length, const struct sockaddr* from, socklen_t fromLength);
+#endif
+
+// ------------------------
+// Proxy_Configstring
+// ------------------------
+
+void Proxy_Configstring_Set(int index, const char* value);
+qboolean Proxy_Configstring_IsCurrent(int index, const char* value);
+void Proxy_Configstring_WriteBigString(msg_t* msg, int index);
+
+// ------------------------
+// Proxy_Cvar
+// ------------------------
+
+#define XCVAR_PROTO
+	#include "Proxy_XCvar.hpp"
+#undef XCVAR_PROTO
+
+void Proxy_Cvar_Register(void);
+void Proxy_Cvar_Update(void);
+
+// ------------------------
+// Proxy_Delta
+// ------------------------
+
+int Proxy_Delta_CompareWords(const void* from, const void* to, int numWords, uint32_t* changedWords);
+qboolean Proxy_Delta_Equal(const void* from, const void* to, int size);
+int Proxy_Delta_EntityStateChanges(const entityState_t* from, const entityState_t* to, uint32_t* changedWords);
+void Proxy_Delta_UpdateDirtyEntities(void);
+int Proxy_Delta_EntityChangeTime(int num);
+int Proxy_Delta_Compare(const entityState_t* from, const entityState_t* to, entityDelta_t* delta);
+void Proxy_Delta_ResetEncodings(void);
+uint32_t Proxy_Delta_HashEncoding(entityDelta_t* delta, const entityState_t* from, const entityState_t* to, qboolean force);
+const byte* Proxy_Delta_FindEncoding(const entityDelta_t* delta, const entityState_t* from, const entityState_t* to, qboolean force, uint32_t hash, int* numBits);
+byte* Proxy_Delta_StoreEncoding(const entityDelta_t* delta, const entityState_t* from, const entityState_t* to, qboolean force, uint32_t hash, int numBits);
+
+// ------------------------
+// Proxy_Demo
+// ------------------------
+
+qboolean Proxy_Demo_ConsoleCommand(void);
+void Proxy_Demo_RunFrame(void);
+void Proxy_Demo_Message(client_t* client, msg_t* msg);
+void Proxy_Demo_Shutdown(void);
+
 // ------------------------
 // Proxy_Files
 // ------------------------
 
 void Proxy_LoadOriginalGameLibrary(void);
 
+// ------------------------
+// Proxy_Filter
+// ------------------------
+
+void Proxy_Filter_Load(void);
+void Proxy_Filter_Shutdown(void);
+qboolean Proxy_Filter_ConsoleCommand(void);
+#ifndef _MSC_VER
+qboolean Proxy_Filter_Packet(const void* data, int length, const struct sockaddr* from);
+#endif
+
+// ------------------------
+// Proxy_FilterRules
+// ------------------------
+
+filterRules_t* Proxy_FilterRules_New(void);
+void Proxy_FilterRules_Free(filterRules_t* rules);
+int Proxy_FilterRules_Count(const filterRules_t* rules);
+qboolean Proxy_FilterRules_ParseLine(filterRules_t* rules, const char* line);
+filterRule_t Proxy_FilterRules_Match(const filterRules_t* rules, uint32_t ip);
+
 // ------------------------
 // Proxy_Imports
 // ------------------------
 
 // -- server utilities
 playerState_t* Proxy_GetPlayerStateByClientNum(int num);
+sharedEntity_t* Proxy_GetEntityByNum(int num);
 void Proxy_ClientCleanName(const char* in, char* out, int outSize);
 
 // -- other
@@ -164,7 +360,13 @@ void Proxy_NewAPI_InitLayerImportTable(void);
 
 // -- Import table
 void Proxy_NewAPI_LocateGameData(sharedEntity_t* gEnts, int numGEntities, int sizeofGEntity_t, playerState_t* clients, int sizeofGameClient);
+int Proxy_NewAPI_BotGetSnapshotEntity(int clientNum, int sequence);
+void Proxy_NewAPI_DropClient(int clientNum, const char* reason);
+void Proxy_NewAPI_GetConfigstring(int num, char* buffer, int bufferSize);
 void Proxy_NewAPI_GetUsercmd(int clientNum, usercmd_t* cmd);
+void Proxy_NewAPI_SendServerCommand(int clientNum, const char* text);
+void Proxy_NewAPI_SetConfigstring(int num, const char* string);
+void Proxy_NewAPI_SetServerCull(float cullDistance);
 
 // -- Export table
 void Proxy_NewAPI_ClientBegin(int clientNum, qboolean allowTeamReset);
@@ -172,6 +374,7 @@ void Proxy_NewAPI_ClientCommand(int clientNum);
 char* Proxy_NewAPI_ClientConnect(int clientNum, qboolean firstTime, qboolean isBot);
 void Proxy_NewAPI_ClientThink(int clientNum, usercmd_t* ucmd);
 qboolean Proxy_NewAPI_ClientUserinfoChanged(int clientNum);
+void Proxy_NewAPI_InitGame(int levelTime, int randomSeed, int restart);
 void Proxy_NewAPI_RunFrame(int levelTime);
 void Proxy_NewAPI_ShutdownGame(int restart);
 
@@ -189,6 +392,12 @@ intptr_t QDECL Proxy_OldAPI_SystemCall(intptr_t command, ...);
 // -- Import table
 void Proxy_SharedAPI_LocateGameData(sharedEntity_t* gEnts, int numGEntities, int sizeofGEntity_t, playerState_t* clients, int sizeofGameClient);
 void Proxy_SharedAPI_GetUsercmd(int clientNum, usercmd_t* cmd);
+qboolean Proxy_SharedAPI_SendServerCommand(int clientNum, const char* text);
+qboolean Proxy_SharedAPI_SetConfigstring(int num, const char* string);
+qboolean Proxy_SharedAPI_GetConfigstring(int num, char* buffer, int bufferSize);
+void Proxy_SharedAPI_SetServerCull(float cullDistance);
+void Proxy_SharedAPI_BotGetSnapshotEntity(int clientNum, int sequence);
+void Proxy_SharedAPI_DropClient(int clientNum, const char* reason);
 
 // -- Export table
 void Proxy_SharedAPI_ClientConnect(int clientNum, qboolean firstTime, qboolean isBot);
@@ -196,6 +405,7 @@ void Proxy_SharedAPI_ClientBegin(int clientNum, qboolean allowTeamReset);
 qboolean Proxy_SharedAPI_ClientCommand(int clientNum);
 void Proxy_SharedAPI_ClientThink(int clientNum, usercmd_t* ucmd);
 void Proxy_SharedAPI_ClientUserinfoChanged(int clientNum);
+void Proxy_SharedAPI_RunFrame(int levelTime);
 
 // ------------------------
 // Proxy_SystemCalls
@@ -203,6 +413,29 @@ void Proxy_SharedAPI_ClientUserinfoChanged(int clientNum);
 
 void Proxy_Translate_SystemCalls(void);
 
+// ------------------------
+// Proxy_Net
+// ------------------------
+
+void Proxy_Net_Attach(void);
+void Proxy_Net_Detach(void);
+void Proxy_Net_BeginBatch(void);
+void Proxy_Net_BeginPacing(client_t* client, msg_t* msg);
+void Proxy_Net_EndPacing(client_t* client, int rateMsec);
+#ifndef _MSC_VER
+void** Proxy_Net_FindGotEntry(const char* symbol);
+void Proxy_Net_SetGotEntry(void** entry, void* function);
+void Proxy_Net_SendPacket(int socket, const void* data, int length, const struct sockaddr* to, socklen_t toLength);
+qboolean Proxy_Net_RateAllow(proxyRateBucket_t* buckets, int numBuckets, uint32_t address, int rate);
+#endif
+
+// ------------------------
+// Proxy_Occlusion
+// ------------------------
+
+void Proxy_Occlusion_RunFrame(int levelTime);
+qboolean Proxy_Occlusion_IsHidden(int viewerNum, int targetNum);
+
 // ------------------------
 // Proxy_Patch
 // ------------------------
@@ -210,6 +443,37 @@ void Proxy_Translate_SystemCalls(void);
 void Proxy_Patch_Attach(void);
 void Proxy_Patch_Detach(void);
 
+// ------------------------
+// Proxy_Query
+// ------------------------
+
+#ifndef _MSC_VER
+qboolean Proxy_Query_Packet(int socket, const void* data, int length, const struct sockaddr* from, socklen_t fromLength);
+void Proxy_Query_Response(const void* data, int length);
+void Proxy_Query_EndCapture(void);
+#endif
+
+// ------------------------
+// Proxy_Relay
+// ------------------------
+
+void Proxy_Relay_Close(void);
+void Proxy_Relay_UpdatePath(void);
+void Proxy_Relay_RunFrame(void);
+void Proxy_Relay_Message(client_t* client, msg_t* msg);
+
+// ------------------------
+// Proxy_ServerCommand
+// ------------------------
+
+void Proxy_ServerCommand_BeginFrame(void);
+void Proxy_ServerCommand_EndFrame(void);
+void Proxy_ServerCommand_Flush(void);
+uint32_t Proxy_ServerCommand_Hash(const char* text);
+qboolean Proxy_ServerCommand_Queue(int clientNum, const char* text);
+qboolean Proxy_ServerCommand_QueueConfigstring(int index, const char* value);
+qboolean Proxy_ServerCommand_GetConfigstring(int index, char* buffer, int bufferSize);
+
 // ------------------------
 // Proxy_Server
 // ------------------------
@@ -219,6 +483,17 @@ void Proxy_Server_CalcPacketsAndFPS(int clientNum, int* packets, int* fps);
 void Proxy_Server_UpdateUcmdStats(int clientNum, usercmd_t* cmd, int packetIndex);
 void Proxy_Server_UpdateTimenudge(client_t* client, usercmd_t* cmd, int _Milliseconds);
 
+// ------------------------
+// Proxy_Snapshot
+// ------------------------
+
+void Proxy_Snapshot_BeginFrame(void);
+svEntity_t* Proxy_Snapshot_FilterEntity(sharedEntity_t* gEnt, svEntity_t* svEnt, void* returnAddress);
+void Proxy_Snapshot_MessageSent(client_t* client);
+void Proxy_Snapshot_BotSnapshotRead(int clientNum);
+void Proxy_Snapshot_Attach(void);
+void Proxy_Snapshot_Detach(void);
+
 // ------------------------
 // Proxy_ClientCommand
 // ------------------------
@@ -14,6 +14,16 @@ playerState_t* Proxy_GetPlayerStateByClientNum(int num)
 	return ps;
 }
 
+// sharedEntity_t* SV_GentityNum(int num)
+sharedEntity_t* Proxy_GetEntityByNum(int num)
+{
+	sharedEntity_t* ent;
+
+	ent = (sharedEntity_t*)((byte*)proxy.locatedGameData.g_entities + proxy.locatedGameData.g_entitySize * (num));
+
+	return ent;
+}
+
 /*
 ===========
 SV_ClientCleanName
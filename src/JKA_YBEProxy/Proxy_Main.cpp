@@ -84,6 +84,8 @@ Q_CABI Q_EXPORT intptr_t vmMain(intptr_t command, intptr_t arg0, intptr_t arg1,
 				proxy.trap->Print("----- Proxy: Engine properly patched\n");
 			}
 
+			Proxy_Cvar_Register();
+
 			break;
 		}
 		//==================================================
@@ -102,6 +104,10 @@ Q_CABI Q_EXPORT intptr_t vmMain(intptr_t command, intptr_t arg0, intptr_t arg1,
 					Proxy_Patch_Detach();
 
 					proxy.trap->Print("----- Proxy: Engine properly unpatched\n");
+
+					Proxy_Relay_Close();
+					Proxy_Demo_Shutdown();
+					Proxy_Filter_Shutdown();
 				}
 
 				proxy.trap->Print("----- Proxy: Unloading original game library %s\n", PROXY_LIBRARY_NAME PROXY_LIBRARY_DOT PROXY_LIBRARY_EXT);
@@ -154,6 +160,29 @@ Q_CABI Q_EXPORT intptr_t vmMain(intptr_t command, intptr_t arg0, intptr_t arg1,
 			return response;
 		}
 		//==================================================
+		case GAME_CONSOLE_COMMAND: // (void)
+		//==================================================
+		{
+			if (Proxy_Demo_ConsoleCommand() || Proxy_Filter_ConsoleCommand())
+			{
+				return qtrue;
+			}
+
+			break;
+		}
+		//==================================================
+		case GAME_RUN_FRAME: // (int levelTime)
+		//==================================================
+		{
+			Proxy_ServerCommand_BeginFrame();
+
+			int response = proxy.originalVmMain(command, arg0, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9, arg10, arg11);
+
+			Proxy_SharedAPI_RunFrame((int)arg0);
+
+			return response;
+		}
+		//==================================================
 		case GAME_CLIENT_USERINFO_CHANGED: // (int clientNum)
 		//==================================================
 		{
@@ -0,0 +1,1118 @@
+#include "Proxy_Header.hpp"
+#include "DetourPatcher/DetourPatcher.hpp"
+
+// ==================================================
+// Network thread (proxy_sv_netThread)
+// --------------------------------------------------
+// The engine reads its UDP socket with one recvfrom per
+// datagram in its frame and sleeps in select on it.
+// These libc calls of the engine are redirected through
+// its GOT: a thread reads the socket with recvmmsg into a
+// ring of packets, the recvfrom of the engine takes the
+// next packet of the ring without a syscall and select
+// is woken up by the thread when packets arrive.
+// Linux only, the Windows engine keeps reading the socket.
+// ==================================================
+
+// ==================================================
+// Send batching (proxy_sv_netBatch)
+// --------------------------------------------------
+// The sendto of the engine during the snapshot pass are
+// queued and the whole frame goes out with one sendmmsg
+// when the engine is done (its next recvfrom or select).
+// With proxy_sv_netBatch 2 the fragments of a message to
+// a client are also sent as one UDP GSO datagram, the
+// kernel splits it again. On any sendmmsg error the rest
+// of the queue is sent with sendto like the engine would.
+// ==================================================
+
+// ==================================================
+// Send thread (proxy_sv_netSendThread)
+// --------------------------------------------------
+// With send batching, the batch of the frame is handed to
+// a thread and the engine goes on with its next frame (or
+// its sleep) while the thread does the sendmmsg. The batch
+// is double buffered, the engine fills one while the
+// thread sends the other, the engine only waits for the
+// thread when it's still sending the last batch.
+// Only the sends overlap the next frame: the snapshots are
+// still built and encoded by the engine on its thread, the
+// world state isn't copied to be snapshotted in parallel.
+// ==================================================
+
+// ==================================================
+// Snapshot pacing (proxy_sv_snapshotPacing)
+// --------------------------------------------------
+// The engine only sends in its frames, a client asking
+// for more snapshots than sv_fps allows in a multiple of
+// the frame gets them late, all at the frame start.
+// Each client gets its own due time instead (last due +
+// its rate msec), the engine builds the snapshot in the
+// last frame before it and a thread sends it on time.
+// Fragmented messages, gamestates and LAN clients are
+// left to the engine.
+// ==================================================
+
+#ifndef _MSC_VER
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <link.h>
+
+#define NET_RING_SIZE		4096	// power of 2
+#define NET_PACKET_SIZE		2048	// client packets are smaller than a netchan fragment
+#define NET_RECV_BATCH		64
+#define NET_SEND_BATCH		256
+#define NET_GSO_MAX_SIZE	65000	// UDP datagram limit minus headers
+#define NET_GSO_MAX_SEGMENTS	64		// UDP_MAX_SEGMENTS of the kernel
+#define NET_PACE_SLOTS		512
+#define NET_FRAGMENT_SIZE	(1400 - 100)	// FRAGMENT_SIZE of the netchan
+
+#ifndef UDP_SEGMENT
+	#define UDP_SEGMENT		103
+#endif
+
+#if defined(__x86_64__) || defined(__LP64__)
+	#define NET_R_SYM(info)	ELF64_R_SYM(info)
+#else
+	#define NET_R_SYM(info)	ELF32_R_SYM(info)
+#endif
+
+typedef struct netPacket_s
+{
+	int							length;
+	socklen_t					fromLength;
+	struct sockaddr_storage		from;
+	byte						data[NET_PACKET_SIZE];
+} netPacket_t;
+
+typedef ssize_t (*recvfromFuncPtr_t)(int, void*, size_t, int, struct sockaddr*, socklen_t*);
+typedef int (*selectFuncPtr_t)(int, fd_set*, fd_set*, fd_set*, struct timeval*);
+typedef ssize_t (*sendtoFuncPtr_t)(int, const void*, size_t, int, const struct sockaddr*, socklen_t);
+
+static struct Net_s {
+	// GOT entries of the engine
+	recvfromFuncPtr_t*		recvfromEntry;
+	recvfromFuncPtr_t		originalRecvfrom;
+	selectFuncPtr_t*		selectEntry;
+	selectFuncPtr_t			originalSelect;
+
+	int						socket;			// the engine socket once it read it
+	qboolean				running;
+	int						wakePipe[2];	// written by the thread when it got packets
+
+	// The thread writes at head and the engine reads at tail
+	netPacket_t				ring[NET_RING_SIZE];
+	std::atomic<uint32_t>	head;
+	std::atomic<uint32_t>	tail;
+	std::atomic<bool>		quit;
+	std::thread				thread;
+} net = { NULL, NULL, NULL, NULL, -1, qfalse, { -1, -1 } };
+
+typedef struct netSendBuffer_s
+{
+	int						socket;
+	qboolean				gso;
+	int						numPackets;
+	netPacket_t				packets[NET_SEND_BATCH];	// from is the destination
+
+	// One message per destination run, a run has several packets with GSO only
+	int						numMessages;
+	struct mmsghdr			messages[NET_SEND_BATCH];
+	int						firstPacket[NET_SEND_BATCH];
+	struct iovec			iovs[NET_SEND_BATCH];
+	byte					control[NET_SEND_BATCH][CMSG_SPACE(sizeof(uint16_t))];
+} netSendBuffer_t;
+
+static struct NetSend_s {
+	sendtoFuncPtr_t*		sendtoEntry;
+	sendtoFuncPtr_t			originalSendto;
+
+	qboolean				batching;
+	std::atomic<bool>		gsoFailed;		// the kernel or the interface don't do GSO
+	std::atomic<int>		gsoError;
+	qboolean				gsoReported;
+	netSendBuffer_t			buffers[2];
+	netSendBuffer_t*		batch;			// filled by the engine
+
+	// Send thread
+	qboolean				running;
+	std::thread				thread;
+	std::mutex				mutex;
+	std::condition_variable	wake;
+	std::condition_variable	done;
+	std::atomic<bool>		busy;
+	bool					quit;
+	netSendBuffer_t*		sending;		// under the mutex, NULL when the thread is idle
+} netSend;
+
+typedef struct netPacedPacket_s
+{
+	int64_t		due;	// microseconds
+	int			slot;
+} netPacedPacket_t;
+
+static struct NetPacer_s {
+	// Main thread
+	int64_t							currentDue;				// of the message being transmitted, 0 when not paced
+	int64_t							nextDue[MAX_CLIENTS];	// 0 when the client isn't paced
+
+	qboolean						running;
+	std::thread						thread;
+	std::mutex						mutex;
+	std::condition_variable			wake;
+	bool							quit;
+
+	// Under the mutex, queue is a heap on due
+	int								sockets[NET_PACE_SLOTS];
+	netPacket_t						packets[NET_PACE_SLOTS];	// from is the destination
+	int								freeSlots[NET_PACE_SLOTS];
+	int								numFreeSlots;
+	std::vector<netPacedPacket_t>	queue;
+} pacer;
+
+typedef struct gotSearch_s
+{
+	const char*	symbol;
+	void**		entry;
+} gotSearch_t;
+
+static void Proxy_Net_SearchRelocations(gotSearch_t* search, struct dl_phdr_info* info, ElfW(Addr) table, size_t tableSize, size_t entrySize, ElfW(Addr) symTab, ElfW(Addr) strTab)
+{
+	for (size_t offset = 0; table && entrySize && offset < tableSize && !search->entry; offset += entrySize)
+	{
+		// r_offset and r_info come first in Rel and Rela
+		const ElfW(Rel)* rel = (const ElfW(Rel)*)(table + offset);
+		const ElfW(Sym)* sym = (const ElfW(Sym)*)symTab + NET_R_SYM(rel->r_info);
+
+		if (NET_R_SYM(rel->r_info) && !strcmp((const char*)strTab + sym->st_name, search->symbol))
+		{
+			search->entry = (void**)(info->dlpi_addr + rel->r_offset);
+		}
+	}
+}
+
+// The engine is the first object, its PLT relocations (or its GOT relocations
+// when it was built without lazy binding) give the GOT entry of the symbol
+static int Proxy_Net_FindGotEntryCallback(struct dl_phdr_info* info, size_t, void* data)
+{
+	gotSearch_t* search = (gotSearch_t*)data;
+	ElfW(Dyn)* dyn = NULL;
+	ElfW(Addr) jmpRel = 0, rel = 0, symTab = 0, strTab = 0;
+	size_t pltRelSize = 0, relSize = 0, relEntrySize = 0;
+	int pltRel = DT_REL;
+	int i;
+
+	for (i = 0; i < info->dlpi_phnum; i++)
+	{
+		if (info->dlpi_phdr[i].p_type == PT_DYNAMIC)
+		{
+			dyn = (ElfW(Dyn)*)(info->dlpi_addr + info->dlpi_phdr[i].p_vaddr);
+			break;
+		}
+	}
+
+	if (!dyn)
+	{
+		return 1;
+	}
+
+	for (; dyn->d_tag != DT_NULL; dyn++)
+	{
+		switch (dyn->d_tag)
+		{
+			case DT_JMPREL:		jmpRel = dyn->d_un.d_ptr; break;
+			case DT_PLTRELSZ:	pltRelSize = dyn->d_un.d_val; break;
+			case DT_PLTREL:		pltRel = (int)dyn->d_un.d_val; break;
+			case DT_REL:
+			case DT_RELA:		rel = dyn->d_un.d_ptr; break;
+			case DT_RELSZ:
+			case DT_RELASZ:		relSize = dyn->d_un.d_val; break;
+			case DT_RELENT:
+			case DT_RELAENT:	relEntrySize = dyn->d_un.d_val; break;
+			case DT_SYMTAB:		symTab = dyn->d_un.d_ptr; break;
+			case DT_STRTAB:		strTab = dyn->d_un.d_ptr; break;
+			default:			break;
+		}
+	}
+
+	if (!symTab || !strTab)
+	{
+		return 1;
+	}
+
+	// Not relocated by the loader on every platform
+	if (symTab < info->dlpi_addr)
+	{
+		jmpRel += jmpRel ? info->dlpi_addr : 0;
+		rel += rel ? info->dlpi_addr : 0;
+		symTab += info->dlpi_addr;
+		strTab += info->dlpi_addr;
+	}
+
+	Proxy_Net_SearchRelocations(search, info, jmpRel, pltRelSize, pltRel == DT_RELA ? sizeof(ElfW(Rela)) : sizeof(ElfW(Rel)), symTab, strTab);
+	Proxy_Net_SearchRelocations(search, info, rel, relSize, relEntrySize, symTab, strTab);
+
+	return 1;
+}
+
+void** Proxy_Net_FindGotEntry(const char* symbol)
+{
+	gotSearch_t search = { symbol, NULL };
+
+	dl_iterate_phdr(Proxy_Net_FindGotEntryCallback, &search);
+
+	return search.entry;
+}
+
+void Proxy_Net_SetGotEntry(void** entry, void* function)
+{
+	UnProtect(entry, sizeof(*entry));
+	*entry = function;
+	ReProtect(entry, sizeof(*entry));
+}
+
+static void Proxy_Net_Thread(void)
+{
+	static struct mmsghdr messages[NET_RECV_BATCH];
+	static struct iovec iovs[NET_RECV_BATCH];
+
+	while (!net.quit.load(std::memory_order_relaxed))
+	{
+		struct pollfd pfd = { net.socket, POLLIN, 0 };
+		uint32_t head = net.head.load(std::memory_order_relaxed);
+		uint32_t space = NET_RING_SIZE - (head - net.tail.load(std::memory_order_acquire));
+		int numMessages = space < NET_RECV_BATCH ? (int)space : NET_RECV_BATCH;
+		int i, received;
+
+		// The engine is behind, let the socket buffer the packets
+		if (!numMessages)
+		{
+			usleep(1000);
+			continue;
+		}
+
+		if (poll(&pfd, 1, 100) <= 0)
+		{
+			continue;
+		}
+
+		for (i = 0; i < numMessages; i++)
+		{
+			netPacket_t* packet = &net.ring[(head + i) & (NET_RING_SIZE - 1)];
+
+			iovs[i].iov_base = packet->data;
+			iovs[i].iov_len = sizeof(packet->data);
+
+			memset(&messages[i].msg_hdr, 0, sizeof(messages[i].msg_hdr));
+			messages[i].msg_hdr.msg_name = &packet->from;
+			messages[i].msg_hdr.msg_namelen = sizeof(packet->from);
+			messages[i].msg_hdr.msg_iov = &iovs[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		received = recvmmsg(net.socket, messages, numMessages, MSG_DONTWAIT, NULL);
+
+		if (received <= 0)
+		{
+			continue;
+		}
+
+		for (i = 0; i < received; i++)
+		{
+			netPacket_t* packet = &net.ring[(head + i) & (NET_RING_SIZE - 1)];
+
+			// Oversize for the engine anyway, it would drop it
+			packet->length = (messages[i].msg_hdr.msg_flags & MSG_TRUNC) ? -1 : (int)messages[i].msg_len;
+			packet->fromLength = messages[i].msg_hdr.msg_namelen;
+		}
+
+		net.head.store(head + received, std::memory_order_release);
+
+		if (write(net.wakePipe[1], "", 1) < 0)
+		{
+			// Full, the engine has a wake up pending anyway
+		}
+	}
+}
+
+static void Proxy_Net_Start(int socket)
+{
+	if (pipe(net.wakePipe) == -1)
+	{
+		return;
+	}
+
+	fcntl(net.wakePipe[0], F_SETFL, fcntl(net.wakePipe[0], F_GETFL) | O_NONBLOCK);
+	fcntl(net.wakePipe[1], F_SETFL, fcntl(net.wakePipe[1], F_GETFL) | O_NONBLOCK);
+
+	net.socket = socket;
+	net.head = 0;
+	net.tail = 0;
+	net.quit = false;
+	net.thread = std::thread(Proxy_Net_Thread);
+	net.running = qtrue;
+}
+
+// The packets still in the ring are lost, the engine recovers from these as from any packet loss
+static void Proxy_Net_Stop(void)
+{
+	if (!net.running)
+	{
+		return;
+	}
+
+	net.quit = true;
+	net.thread.join();
+	net.running = qfalse;
+
+	close(net.wakePipe[0]);
+	close(net.wakePipe[1]);
+	net.wakePipe[0] = net.wakePipe[1] = -1;
+}
+
+/*
+==================
+Proxy_Net_BuildMessages
+
+Packets to the same address following a full size packet
+join its message as GSO segments, the last one may be shorter
+==================
+*/
+static void Proxy_Net_BuildMessages(netSendBuffer_t* buffer)
+{
+	int i, count;
+
+	buffer->numMessages = 0;
+
+	for (i = 0; i < buffer->numPackets; i += count)
+	{
+		netPacket_t* first = &buffer->packets[i];
+		struct msghdr* header = &buffer->messages[buffer->numMessages].msg_hdr;
+
+		count = 1;
+
+		if (buffer->gso)
+		{
+			while (i + count < buffer->numPackets
+				&& buffer->packets[i + count - 1].length == first->length
+				&& buffer->packets[i + count].length <= first->length
+				&& count < NET_GSO_MAX_SEGMENTS
+				&& (count + 1) * first->length <= NET_GSO_MAX_SIZE
+				&& buffer->packets[i + count].fromLength == first->fromLength
+				&& !memcmp(&buffer->packets[i + count].from, &first->from, first->fromLength))
+			{
+				count++;
+			}
+		}
+
+		memset(header, 0, sizeof(*header));
+		header->msg_name = &first->from;
+		header->msg_namelen = first->fromLength;
+		header->msg_iov = &buffer->iovs[i];
+		header->msg_iovlen = count;
+
+		if (count > 1)
+		{
+			struct cmsghdr* cmsg;
+
+			header->msg_control = buffer->control[buffer->numMessages];
+			header->msg_controllen = sizeof(buffer->control[buffer->numMessages]);
+
+			cmsg = CMSG_FIRSTHDR(header);
+			cmsg->cmsg_level = IPPROTO_UDP;
+			cmsg->cmsg_type = UDP_SEGMENT;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+			*(uint16_t*)CMSG_DATA(cmsg) = (uint16_t)first->length;
+		}
+
+		buffer->firstPacket[buffer->numMessages] = i;
+		buffer->numMessages++;
+	}
+}
+
+// Doesn't touch the engine, called from the send thread too
+static void Proxy_Net_SendBatch(netSendBuffer_t* buffer)
+{
+	int i, sent = 0;
+
+	if (!buffer->numPackets)
+	{
+		return;
+	}
+
+	for (i = 0; i < buffer->numPackets; i++)
+	{
+		buffer->iovs[i].iov_base = buffer->packets[i].data;
+		buffer->iovs[i].iov_len = buffer->packets[i].length;
+	}
+
+	Proxy_Net_BuildMessages(buffer);
+
+	while (sent < buffer->numMessages)
+	{
+		int result = sendmmsg(buffer->socket, buffer->messages + sent, buffer->numMessages - sent, 0);
+
+		if (result > 0)
+		{
+			sent += result;
+			continue;
+		}
+
+		if (result == -1 && errno == EINTR)
+		{
+			continue;
+		}
+
+		// GSO is refused by the kernel or the interface, the remaining packets are sent one by one below
+		if (buffer->messages[sent].msg_hdr.msg_controllen && (errno == EINVAL || errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP))
+		{
+			netSend.gsoError = errno;
+			netSend.gsoFailed = true;
+		}
+
+		break;
+	}
+
+	// The engine ignores send errors (full socket buffer...), the packets are dropped the same way here
+	for (i = sent < buffer->numMessages ? buffer->firstPacket[sent] : buffer->numPackets; i < buffer->numPackets; i++)
+	{
+		netPacket_t* packet = &buffer->packets[i];
+
+		netSend.originalSendto(buffer->socket, packet->data, packet->length, 0, (struct sockaddr*)&packet->from, packet->fromLength);
+	}
+
+	buffer->numPackets = 0;
+}
+
+static void Proxy_Net_SenderThread(void)
+{
+	std::unique_lock<std::mutex> lock(netSend.mutex);
+
+	for (;;)
+	{
+		if (!netSend.sending)
+		{
+			if (netSend.quit)
+			{
+				break;
+			}
+
+			netSend.wake.wait(lock);
+			continue;
+		}
+
+		lock.unlock();
+		Proxy_Net_SendBatch(netSend.sending);
+		lock.lock();
+
+		netSend.sending = NULL;
+		netSend.busy = false;
+		netSend.done.notify_all();
+	}
+}
+
+// The packets sent outside of the batches don't overtake the last batch
+static void Proxy_Net_WaitSender(void)
+{
+	if (!netSend.busy.load(std::memory_order_acquire))
+	{
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(netSend.mutex);
+
+	netSend.done.wait(lock, [] { return netSend.sending == NULL; });
+}
+
+static void Proxy_Net_StopSender(void)
+{
+	if (!netSend.running)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(netSend.mutex);
+		netSend.quit = true;
+	}
+
+	netSend.wake.notify_one();
+	netSend.thread.join();
+	netSend.running = qfalse;
+}
+
+// Sends the batch now or hands it to the send thread
+static void Proxy_Net_FlushBatch(void)
+{
+	netSendBuffer_t* batch = netSend.batch;
+
+	if (!batch->numPackets)
+	{
+		return;
+	}
+
+	batch->gso = (qboolean)(proxy_sv_netBatch.integer >= 2 && !netSend.gsoFailed);
+
+	if (!proxy_sv_netSendThread.integer)
+	{
+		Proxy_Net_StopSender();
+		Proxy_Net_SendBatch(batch);
+
+		return;
+	}
+
+	if (!netSend.running)
+	{
+		netSend.quit = false;
+		netSend.sending = NULL;
+		netSend.busy = false;
+		netSend.thread = std::thread(Proxy_Net_SenderThread);
+		netSend.running = qtrue;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(netSend.mutex);
+
+		netSend.done.wait(lock, [] { return netSend.sending == NULL; });
+		netSend.sending = batch;
+		netSend.busy = true;
+	}
+
+	netSend.wake.notify_one();
+	netSend.batch = batch == &netSend.buffers[0] ? &netSend.buffers[1] : &netSend.buffers[0];
+}
+
+// Called from Proxy_SV_SendMessageToClient, the first message of the frame starts the batch
+void Proxy_Net_BeginBatch(void)
+{
+	if (netSend.sendtoEntry && proxy_sv_netBatch.integer)
+	{
+		netSend.batching = qtrue;
+	}
+}
+
+static void Proxy_Net_EndBatch(void)
+{
+	if (netSend.batching)
+	{
+		Proxy_Net_FlushBatch();
+		netSend.batching = qfalse;
+	}
+
+	if (netSend.gsoFailed && !netSend.gsoReported)
+	{
+		proxy.trap->Print("----- Proxy: UDP GSO not supported (%s), sending the fragments separately\n", strerror(netSend.gsoError));
+		netSend.gsoReported = qtrue;
+	}
+}
+
+static int64_t Proxy_Net_Microseconds(void)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool Proxy_Net_PacedLater(const netPacedPacket_t& a, const netPacedPacket_t& b)
+{
+	return a.due > b.due;
+}
+
+static void Proxy_Net_PacerThread(void)
+{
+	std::unique_lock<std::mutex> lock(pacer.mutex);
+
+	for (;;)
+	{
+		if (pacer.queue.empty())
+		{
+			if (pacer.quit)
+			{
+				break;
+			}
+
+			pacer.wake.wait(lock);
+			continue;
+		}
+
+		int64_t wait = pacer.queue.front().due - Proxy_Net_Microseconds();
+
+		// Whatever is left goes out now on quit
+		if (wait > 0 && !pacer.quit)
+		{
+			pacer.wake.wait_for(lock, std::chrono::microseconds(wait));
+			continue;
+		}
+
+		std::pop_heap(pacer.queue.begin(), pacer.queue.end(), Proxy_Net_PacedLater);
+		int slot = pacer.queue.back().slot;
+		pacer.queue.pop_back();
+
+		netPacket_t* packet = &pacer.packets[slot];
+
+		netSend.originalSendto(pacer.sockets[slot], packet->data, packet->length, 0, (struct sockaddr*)&packet->from, packet->fromLength);
+		pacer.freeSlots[pacer.numFreeSlots++] = slot;
+	}
+}
+
+static void Proxy_Net_StopPacer(void)
+{
+	if (!pacer.running)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pacer.mutex);
+		pacer.quit = true;
+	}
+
+	pacer.wake.notify_one();
+	pacer.thread.join();
+	pacer.running = qfalse;
+}
+
+static qboolean Proxy_Net_PacePacket(int socket, const void* buffer, size_t length, const struct sockaddr* to, socklen_t toLength)
+{
+	netPacedPacket_t paced;
+	netPacket_t* packet;
+
+	if (!to || length > NET_PACKET_SIZE || toLength > sizeof(packet->from))
+	{
+		return qfalse;
+	}
+
+	if (!pacer.running)
+	{
+		int i;
+
+		for (i = 0; i < NET_PACE_SLOTS; i++)
+		{
+			pacer.freeSlots[i] = i;
+		}
+
+		pacer.numFreeSlots = NET_PACE_SLOTS;
+		pacer.queue.clear();
+		pacer.queue.reserve(NET_PACE_SLOTS);
+		pacer.quit = false;
+		pacer.thread = std::thread(Proxy_Net_PacerThread);
+		pacer.running = qtrue;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pacer.mutex);
+
+		if (!pacer.numFreeSlots)
+		{
+			return qfalse;
+		}
+
+		paced.due = pacer.currentDue;
+		paced.slot = pacer.freeSlots[--pacer.numFreeSlots];
+
+		packet = &pacer.packets[paced.slot];
+		packet->length = (int)length;
+		packet->fromLength = toLength;
+		memcpy(&packet->from, to, toLength);
+		memcpy(packet->data, buffer, length);
+		pacer.sockets[paced.slot] = socket;
+
+		pacer.queue.push_back(paced);
+		std::push_heap(pacer.queue.begin(), pacer.queue.end(), Proxy_Net_PacedLater);
+	}
+
+	pacer.wake.notify_one();
+
+	return qtrue;
+}
+
+/*
+==================
+Proxy_Net_BeginPacing
+
+Called from Proxy_SV_SendMessageToClient before the
+message is transmitted, a message built ahead of the
+due time of the client is held until then
+==================
+*/
+void Proxy_Net_BeginPacing(client_t* client, msg_t* msg)
+{
+	int clientNum = client - server.svs->clients;
+	int64_t now = Proxy_Net_Microseconds();
+
+	pacer.currentDue = 0;
+
+	if (!proxy_sv_snapshotPacing.integer || !netSend.sendtoEntry || client->state != CS_ACTIVE
+		|| client->gamestateMessageNum == client->netchan.outgoingSequence || msg->cursize >= NET_FRAGMENT_SIZE
+		|| client->netchan.remoteAddress.type == NA_LOOPBACK || server.common.functions.Sys_IsLANAddress(client->netchan.remoteAddress))
+	{
+		pacer.nextDue[clientNum] = 0;
+		return;
+	}
+
+	if (pacer.nextDue[clientNum] > now)
+	{
+		pacer.currentDue = pacer.nextDue[clientNum];
+
+		// The ping is measured from the real send time
+		client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent += (int)((pacer.currentDue - now) / 1000);
+	}
+
+	// Late (or the first one), the schedule starts again from now
+	pacer.nextDue[clientNum] = pacer.currentDue ? pacer.currentDue : now;
+}
+
+/*
+==================
+Proxy_Net_EndPacing
+
+Called once nextSnapshotTime is set, the next due time
+is exactly rateMsec after this one and the snapshot is
+built in the last frame before it
+==================
+*/
+void Proxy_Net_EndPacing(client_t* client, int rateMsec)
+{
+	int clientNum = client - server.svs->clients;
+	int frameMsec = 1000 / server.cvars.sv_fps->integer;
+	int aheadMsec;
+
+	pacer.currentDue = 0;
+
+	if (!pacer.nextDue[clientNum])
+	{
+		return;
+	}
+
+	pacer.nextDue[clientNum] += (int64_t)rateMsec * 1000;
+	aheadMsec = (int)((pacer.nextDue[clientNum] - Proxy_Net_Microseconds()) / 1000);
+
+	client->nextSnapshotTime = server.svs->time + aheadMsec - frameMsec + 1;
+
+	if (client->nextSnapshotTime <= server.svs->time)
+	{
+		client->nextSnapshotTime = server.svs->time + 1;
+	}
+}
+
+static ssize_t Proxy_Net_Sendto(int socket, const void* buffer, size_t length, int flags, const struct sockaddr* to, socklen_t toLength)
+{
+	netPacket_t* packet;
+
+	Proxy_Query_Response(buffer, (int)length);
+
+	if (pacer.currentDue && Proxy_Net_PacePacket(socket, buffer, length, to, toLength))
+	{
+		return length;
+	}
+
+	if (!netSend.batching || !to || length > NET_PACKET_SIZE || toLength > sizeof(packet->from) || (netSend.batch->numPackets && socket != netSend.batch->socket))
+	{
+		Proxy_Net_WaitSender();
+
+		return netSend.originalSendto(socket, buffer, length, flags, to, toLength);
+	}
+
+	if (netSend.batch->numPackets == NET_SEND_BATCH)
+	{
+		Proxy_Net_FlushBatch();
+	}
+
+	packet = &netSend.batch->packets[netSend.batch->numPackets++];
+	packet->length = (int)length;
+	packet->fromLength = toLength;
+	memcpy(&packet->from, to, toLength);
+	memcpy(packet->data, buffer, length);
+
+	netSend.batch->socket = socket;
+
+	return length;
+}
+
+static ssize_t Proxy_Net_ReadPacket(int socket, void* buffer, size_t length, int flags, struct sockaddr* from, socklen_t* fromLength)
+{
+	if (!net.running)
+	{
+		// The only socket read by a dedicated server is the one of the server
+		if (!proxy_sv_netThread.integer)
+		{
+			return net.originalRecvfrom(socket, buffer, length, flags, from, fromLength);
+		}
+
+		Proxy_Net_Start(socket);
+
+		if (!net.running)
+		{
+			return net.originalRecvfrom(socket, buffer, length, flags, from, fromLength);
+		}
+	}
+
+	if (socket != net.socket)
+	{
+		return net.originalRecvfrom(socket, buffer, length, flags, from, fromLength);
+	}
+
+	for (;;)
+	{
+		uint32_t tail = net.tail.load(std::memory_order_relaxed);
+		netPacket_t* packet;
+
+		if (tail == net.head.load(std::memory_order_acquire))
+		{
+			if (!proxy_sv_netThread.integer)
+			{
+				Proxy_Net_Stop();
+
+				return net.originalRecvfrom(socket, buffer, length, flags, from, fromLength);
+			}
+
+			errno = EWOULDBLOCK;
+
+			return -1;
+		}
+
+		packet = &net.ring[tail & (NET_RING_SIZE - 1)];
+
+		if (packet->length < 0)
+		{
+			net.tail.store(tail + 1, std::memory_order_release);
+			continue;
+		}
+
+		ssize_t copied = (size_t)packet->length < length ? packet->length : (ssize_t)length;
+
+		memcpy(buffer, packet->data, copied);
+
+		if (from && fromLength)
+		{
+			socklen_t addressLength = packet->fromLength < *fromLength ? packet->fromLength : *fromLength;
+
+			memcpy(from, &packet->from, addressLength);
+			*fromLength = packet->fromLength;
+		}
+
+		net.tail.store(tail + 1, std::memory_order_release);
+
+		return copied;
+	}
+}
+
+/*
+==================
+Proxy_Net_RateAllow
+
+Token bucket of rate packets per second (and as much
+burst) for the address, numBuckets is a power of 2
+==================
+*/
+qboolean Proxy_Net_RateAllow(proxyRateBucket_t* buckets, int numBuckets, uint32_t address, int rate)
+{
+	proxyRateBucket_t* bucket = &buckets[((address * 2654435761u) >> 16) & (numBuckets - 1)];
+	int time = proxy.trap->Milliseconds();
+	int burst = rate * 1000;
+
+	// An other address takes the slot with a full bucket
+	if (bucket->address != address || time - bucket->time >= 1000)
+	{
+		bucket->address = address;
+		bucket->tokens = burst;
+		bucket->time = time;
+	}
+	else
+	{
+		bucket->tokens += (time - bucket->time) * rate;
+		bucket->time = time;
+
+		if (bucket->tokens > burst)
+		{
+			bucket->tokens = burst;
+		}
+	}
+
+	if (bucket->tokens < 1000)
+	{
+		return qfalse;
+	}
+
+	bucket->tokens -= 1000;
+
+	return qtrue;
+}
+
+// Connectionless packets the proxy answers (or drops) before the engine sees them
+static qboolean Proxy_Net_FilterPacket(int socket, const void* data, int length, const struct sockaddr* from, socklen_t fromLength)
+{
+	return (qboolean)(Proxy_Filter_Packet(data, length, from)
+		|| Proxy_Query_Packet(socket, data, length, from, fromLength)
+		|| Proxy_Challenge_Packet(socket, data, length, from, fromLength));
+}
+
+static ssize_t Proxy_Net_Recvfrom(int socket, void* buffer, size_t length, int flags, struct sockaddr* from, socklen_t* fromLength)
+{
+	ssize_t received;
+
+	// Back in the event loop, the frame (or the last packet) is done
+	Proxy_Net_EndBatch();
+	Proxy_Query_EndCapture();
+
+	do
+	{
+		received = Proxy_Net_ReadPacket(socket, buffer, length, flags, from, fromLength);
+	} while (received > 0 && from && fromLength && Proxy_Net_FilterPacket(socket, buffer, (int)received, from, *fromLength));
+
+	return received;
+}
+
+// Sent as is, for the packets the proxy answers itself
+void Proxy_Net_SendPacket(int socket, const void* data, int length, const struct sockaddr* to, socklen_t toLength)
+{
+	if (netSend.originalSendto)
+	{
+		netSend.originalSendto(socket, data, length, 0, to, toLength);
+	}
+	else
+	{
+		sendto(socket, data, length, 0, to, toLength);
+	}
+}
+
+// NET_Sleep waits on the socket, wait on the pipe of the thread instead
+static int Proxy_Net_Select(int numFds, fd_set* readFds, fd_set* writeFds, fd_set* exceptFds, struct timeval* timeout)
+{
+	char drain[64];
+	int ready;
+
+	Proxy_Net_EndBatch();
+
+	if (!net.running || !readFds || net.socket >= numFds || !FD_ISSET(net.socket, readFds))
+	{
+		return net.originalSelect(numFds, readFds, writeFds, exceptFds, timeout);
+	}
+
+	if (net.tail.load(std::memory_order_relaxed) != net.head.load(std::memory_order_acquire))
+	{
+		FD_ZERO(readFds);
+		FD_SET(net.socket, readFds);
+
+		if (writeFds)
+		{
+			FD_ZERO(writeFds);
+		}
+
+		if (exceptFds)
+		{
+			FD_ZERO(exceptFds);
+		}
+
+		return 1;
+	}
+
+	FD_CLR(net.socket, readFds);
+	FD_SET(net.wakePipe[0], readFds);
+
+	ready = net.originalSelect(numFds > net.wakePipe[0] ? numFds : net.wakePipe[0] + 1, readFds, writeFds, exceptFds, timeout);
+
+	if (ready > 0 && FD_ISSET(net.wakePipe[0], readFds))
+	{
+		while (read(net.wakePipe[0], drain, sizeof(drain)) > 0)
+		{
+		}
+
+		FD_CLR(net.wakePipe[0], readFds);
+		FD_SET(net.socket, readFds);
+	}
+
+	return ready;
+}
+
+void Proxy_Net_Attach(void)
+{
+	netSend.batch = &netSend.buffers[0];
+	netSend.sendtoEntry = (sendtoFuncPtr_t*)Proxy_Net_FindGotEntry("sendto");
+
+	if (netSend.sendtoEntry)
+	{
+		netSend.originalSendto = sendto;
+		Proxy_Net_SetGotEntry((void**)netSend.sendtoEntry, (void*)Proxy_Net_Sendto);
+	}
+	else
+	{
+		proxy.trap->Print("----- Proxy: sendto not found in the engine, send batching unavailable\n");
+	}
+
+	net.recvfromEntry = (recvfromFuncPtr_t*)Proxy_Net_FindGotEntry("recvfrom");
+	net.selectEntry = (selectFuncPtr_t*)Proxy_Net_FindGotEntry("select");
+
+	if (!net.recvfromEntry || !net.selectEntry)
+	{
+		proxy.trap->Print("----- Proxy: recvfrom/select not found in the engine, network thread unavailable\n");
+
+		net.recvfromEntry = NULL;
+		net.selectEntry = NULL;
+
+		return;
+	}
+
+	// The GOT may still point to the resolver, call libc directly
+	net.originalRecvfrom = recvfrom;
+	net.originalSelect = select;
+
+	Proxy_Net_SetGotEntry((void**)net.recvfromEntry, (void*)Proxy_Net_Recvfrom);
+	Proxy_Net_SetGotEntry((void**)net.selectEntry, (void*)Proxy_Net_Select);
+}
+
+void Proxy_Net_Detach(void)
+{
+	Proxy_Net_EndBatch();
+	Proxy_Net_StopSender();
+	Proxy_Net_StopPacer();
+	Proxy_Net_Stop();
+
+	if (netSend.sendtoEntry)
+	{
+		Proxy_Net_SetGotEntry((void**)netSend.sendtoEntry, (void*)netSend.originalSendto);
+	}
+
+	if (net.recvfromEntry)
+	{
+		Proxy_Net_SetGotEntry((void**)net.recvfromEntry, (void*)net.originalRecvfrom);
+		Proxy_Net_SetGotEntry((void**)net.selectEntry, (void*)net.originalSelect);
+	}
+}
+
+#else
+
+void Proxy_Net_BeginBatch(void)
+{
+}
+
+void Proxy_Net_BeginPacing(client_t* client, msg_t* msg)
+{
+}
+
+void Proxy_Net_EndPacing(client_t* client, int rateMsec)
+{
+}
+
+void Proxy_Net_Attach(void)
+{
+}
+
+void Proxy_Net_Detach(void)
+{
+}
+
+#endif
@@ -6,8 +6,14 @@
 
 void Proxy_NewAPI_InitLayerImportTable(void)
 {
+	proxy.copyNewAPIGameImportTable->BotGetSnapshotEntity = Proxy_NewAPI_BotGetSnapshotEntity;
+	proxy.copyNewAPIGameImportTable->DropClient = Proxy_NewAPI_DropClient;
+	proxy.copyNewAPIGameImportTable->GetConfigstring = Proxy_NewAPI_GetConfigstring;
 	proxy.copyNewAPIGameImportTable->GetUsercmd = Proxy_NewAPI_GetUsercmd;
 	proxy.copyNewAPIGameImportTable->LocateGameData = Proxy_NewAPI_LocateGameData;
+	proxy.copyNewAPIGameImportTable->SendServerCommand = Proxy_NewAPI_SendServerCommand;
+	proxy.copyNewAPIGameImportTable->SetConfigstring = Proxy_NewAPI_SetConfigstring;
+	proxy.copyNewAPIGameImportTable->SetServerCull = Proxy_NewAPI_SetServerCull;
 }
 
 void Proxy_NewAPI_InitLayerExportTable(void)
@@ -17,6 +23,7 @@ void Proxy_NewAPI_InitLayerExportTable(void)
 	proxy.copyNewAPIGameExportTable->ClientConnect = Proxy_NewAPI_ClientConnect;
 	proxy.copyNewAPIGameExportTable->ClientThink = Proxy_NewAPI_ClientThink;
 	proxy.copyNewAPIGameExportTable->ClientUserinfoChanged = Proxy_NewAPI_ClientUserinfoChanged;
+	proxy.copyNewAPIGameExportTable->InitGame = Proxy_NewAPI_InitGame;
 	proxy.copyNewAPIGameExportTable->RunFrame = Proxy_NewAPI_RunFrame;
 	proxy.copyNewAPIGameExportTable->ShutdownGame = Proxy_NewAPI_ShutdownGame;
 }
@@ -25,6 +32,30 @@ void Proxy_NewAPI_InitLayerExportTable(void)
 // IMPORT TABLE
 // ==================================================
 
+int Proxy_NewAPI_BotGetSnapshotEntity(int clientNum, int sequence)
+{
+	Proxy_SharedAPI_BotGetSnapshotEntity(clientNum, sequence);
+
+	return proxy.originalNewAPIGameImportTable->BotGetSnapshotEntity(clientNum, sequence);
+}
+
+void Proxy_NewAPI_DropClient(int clientNum, const char* reason)
+{
+	Proxy_SharedAPI_DropClient(clientNum, reason);
+
+	proxy.originalNewAPIGameImportTable->DropClient(clientNum, reason);
+}
+
+void Proxy_NewAPI_GetConfigstring(int num, char* buffer, int bufferSize)
+{
+	if (!Proxy_SharedAPI_GetConfigstring(num, buffer, bufferSize))
+	{
+		return;
+	}
+
+	proxy.originalNewAPIGameImportTable->GetConfigstring(num, buffer, bufferSize);
+}
+
 void Proxy_NewAPI_GetUsercmd(int clientNum, usercmd_t* cmd)
 {
 	Proxy_SharedAPI_GetUsercmd(clientNum, cmd);
@@ -39,6 +70,33 @@ void Proxy_NewAPI_LocateGameData(sharedEntity_t* gEnts, int numGEntities, int si
 	proxy.originalNewAPIGameImportTable->LocateGameData(gEnts, numGEntities, sizeofGEntity_t, clients, sizeofGameClient);
 }
 
+void Proxy_NewAPI_SendServerCommand(int clientNum, const char* text)
+{
+	if (!Proxy_SharedAPI_SendServerCommand(clientNum, text))
+	{
+		return;
+	}
+
+	proxy.originalNewAPIGameImportTable->SendServerCommand(clientNum, text);
+}
+
+void Proxy_NewAPI_SetConfigstring(int num, const char* string)
+{
+	if (!Proxy_SharedAPI_SetConfigstring(num, string))
+	{
+		return;
+	}
+
+	proxy.originalNewAPIGameImportTable->SetConfigstring(num, string);
+}
+
+void Proxy_NewAPI_SetServerCull(float cullDistance)
+{
+	Proxy_SharedAPI_SetServerCull(cullDistance);
+
+	proxy.originalNewAPIGameImportTable->SetServerCull(cullDistance);
+}
+
 // ==================================================
 // EXPORT TABLE
 // ==================================================
@@ -81,9 +139,20 @@ qboolean Proxy_NewAPI_ClientUserinfoChanged(int clientNum)
 	return proxy.originalNewAPIGameExportTable->ClientUserinfoChanged(clientNum);
 }
 
+void Proxy_NewAPI_InitGame(int levelTime, int randomSeed, int restart)
+{
+	Proxy_Cvar_Register();
+
+	proxy.originalNewAPIGameExportTable->InitGame(levelTime, randomSeed, restart);
+}
+
 void Proxy_NewAPI_RunFrame(int levelTime)
 {
+	Proxy_ServerCommand_BeginFrame();
+
 	proxy.originalNewAPIGameExportTable->RunFrame(levelTime);
+
+	Proxy_SharedAPI_RunFrame(levelTime);
 }
 
 void Proxy_NewAPI_ShutdownGame(int restart)
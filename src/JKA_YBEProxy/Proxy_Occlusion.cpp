@@ -0,0 +1,188 @@
+#include "Proxy_Header.hpp"
+
+// ==================================================
+// Occlusion culling (proxy_sv_antiWallhack)
+// --------------------------------------------------
+// Enemy players behind walls are left out of the snapshots
+// so wallhacks have nothing to draw. Visibility between two
+// players is checked with a few world traces from the eye
+// of the viewer to the bounds of the target, the checks are
+// spread over the frames with a trace budget per frame.
+// A player stays visible for a while after the last time
+// it was seen, and anything not checked recently is visible.
+// A player carrying an event or a sound is never left out,
+// the viewer would miss it as it does through the walls.
+// ==================================================
+
+#define OCCLUSION_HYSTERESIS		250		// ms a player stays visible after being seen
+#define OCCLUSION_MAX_CHECK_AGE		1000	// ms after which an unchecked pair is visible
+#define OCCLUSION_VISIBLE_DISTANCE	256.0f	// always visible closer than this
+#define OCCLUSION_SIDE_MARGIN		24.0f	// checks beside the target, peeking around corners
+#define OCCLUSION_MAX_TRACES		5
+
+typedef struct occlusionPair_s
+{
+	int		lastCheckTime;
+	int		lastVisibleTime;
+} occlusionPair_t;
+
+static struct Occlusion_s {
+	occlusionPair_t	pairs[MAX_CLIENTS][MAX_CLIENTS];	// [viewer][target]
+	int				cursor;
+	int				time;
+	qboolean		teamGame;
+} occlusion;
+
+static qboolean Proxy_Occlusion_IsPlayer(int clientNum)
+{
+	sharedEntity_t* ent = Proxy_GetEntityByNum(clientNum);
+
+	return (qboolean)(ent->r.linked && ent->s.eType == ET_PLAYER
+		&& Proxy_GetPlayerStateByClientNum(clientNum)->persistant[PERS_TEAM] != TEAM_SPECTATOR);
+}
+
+static qboolean Proxy_Occlusion_IsEnemy(int viewerNum, int targetNum)
+{
+	if (!occlusion.teamGame)
+	{
+		return qtrue;
+	}
+
+	return (qboolean)(Proxy_GetPlayerStateByClientNum(viewerNum)->persistant[PERS_TEAM] != Proxy_GetPlayerStateByClientNum(targetNum)->persistant[PERS_TEAM]);
+}
+
+// Returns the number of traces done
+static int Proxy_Occlusion_CheckPair(int viewerNum, int targetNum)
+{
+	occlusionPair_t* pair = &occlusion.pairs[viewerNum][targetNum];
+	playerState_t* ps = Proxy_GetPlayerStateByClientNum(viewerNum);
+	sharedEntity_t* target = Proxy_GetEntityByNum(targetNum);
+	vec3_t eye, center, dir, side, points[OCCLUSION_MAX_TRACES];
+	vec3_t up = { 0.0f, 0.0f, 1.0f };
+	float radius;
+	trace_t tr;
+	int i;
+
+	pair->lastCheckTime = occlusion.time;
+
+	VectorCopy(ps->origin, eye);
+	eye[2] += ps->viewheight;
+
+	VectorAdd(target->r.absmin, target->r.absmax, center);
+	VectorScale(center, 0.5f, center);
+	VectorSubtract(center, eye, dir);
+
+	if (VectorLength(dir) < OCCLUSION_VISIBLE_DISTANCE)
+	{
+		pair->lastVisibleTime = occlusion.time;
+
+		return 0;
+	}
+
+	// Center, top, bottom, then both sides as seen from the viewer
+	radius = (target->r.absmax[0] - target->r.absmin[0]) * 0.5f + OCCLUSION_SIDE_MARGIN;
+
+	CrossProduct(dir, up, side);
+	VectorNormalize(side);
+
+	VectorCopy(center, points[0]);
+	VectorSet(points[1], center[0], center[1], target->r.absmax[2] - 1.0f);
+	VectorSet(points[2], center[0], center[1], target->r.absmin[2] + 1.0f);
+	VectorMA(center, radius, side, points[3]);
+	VectorMA(center, -radius, side, points[4]);
+
+	for (i = 0; i < OCCLUSION_MAX_TRACES; i++)
+	{
+		proxy.trap->Trace(&tr, eye, NULL, NULL, points[i], viewerNum, CONTENTS_OPAQUE, qfalse, 0, 0);
+
+		if (tr.fraction >= 1.0f)
+		{
+			pair->lastVisibleTime = occlusion.time;
+
+			return i + 1;
+		}
+	}
+
+	return OCCLUSION_MAX_TRACES;
+}
+
+/*
+==================
+Proxy_Occlusion_RunFrame
+
+Called after the game module ran its frame, checks the
+player pairs following the last one checked until the
+trace budget of the frame is spent
+==================
+*/
+void Proxy_Occlusion_RunFrame(int levelTime)
+{
+	int numPairs = MAX_CLIENTS * MAX_CLIENTS;
+	int numTraces = 0;
+	int i;
+
+	occlusion.time = levelTime;
+
+	if (!proxy_sv_antiWallhack.integer)
+	{
+		return;
+	}
+
+	occlusion.teamGame = (qboolean)(proxy.trap->Cvar_VariableIntegerValue("g_gametype") >= GT_TEAM);
+
+	for (i = 0; i < numPairs && numTraces < proxy_sv_antiWallhackTraces.integer; i++)
+	{
+		int viewerNum = occlusion.cursor / MAX_CLIENTS;
+		int targetNum = occlusion.cursor % MAX_CLIENTS;
+
+		occlusion.cursor = (occlusion.cursor + 1) % numPairs;
+
+		if (viewerNum == targetNum || !Proxy_Occlusion_IsPlayer(viewerNum) || !Proxy_Occlusion_IsPlayer(targetNum))
+		{
+			continue;
+		}
+
+		if (!Proxy_Occlusion_IsEnemy(viewerNum, targetNum))
+		{
+			continue;
+		}
+
+		numTraces += Proxy_Occlusion_CheckPair(viewerNum, targetNum);
+	}
+}
+
+// What the viewer hears through the walls
+static qboolean Proxy_Occlusion_IsAudible(int clientNum)
+{
+	sharedEntity_t* ent = Proxy_GetEntityByNum(clientNum);
+
+	return (qboolean)(ent->s.event || ent->s.loopSound || (ent->s.eFlags & EF_SOUNDTRACKER));
+}
+
+// Whether targetNum must be left out of the snapshots seen from viewerNum
+qboolean Proxy_Occlusion_IsHidden(int viewerNum, int targetNum)
+{
+	occlusionPair_t* pair;
+
+	if (!proxy_sv_antiWallhack.integer || viewerNum == targetNum
+		|| viewerNum < 0 || viewerNum >= MAX_CLIENTS || targetNum < 0 || targetNum >= MAX_CLIENTS)
+	{
+		return qfalse;
+	}
+
+	// The pair may have been checked for a previous player of the slot
+	if (!Proxy_Occlusion_IsPlayer(targetNum) || Proxy_Occlusion_IsAudible(targetNum))
+	{
+		return qfalse;
+	}
+
+	pair = &occlusion.pairs[viewerNum][targetNum];
+
+	// Fail open
+	if (!pair->lastCheckTime || occlusion.time - pair->lastCheckTime > OCCLUSION_MAX_CHECK_AGE || !Proxy_Occlusion_IsEnemy(viewerNum, targetNum))
+	{
+		return qfalse;
+	}
+
+	return (qboolean)(occlusion.time - pair->lastVisibleTime > OCCLUSION_HYSTERESIS);
+}
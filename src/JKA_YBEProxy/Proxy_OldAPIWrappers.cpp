@@ -35,6 +35,67 @@ intptr_t QDECL Proxy_OldAPI_SystemCall(intptr_t command, ...)
 			
 			return response;
 		}
+		//==================================================
+		case G_SEND_SERVER_COMMAND: // (int clientNum, const char* text)
+		//==================================================
+		{
+			if (!Proxy_SharedAPI_SendServerCommand((int)args[0], (const char*)args[1]))
+			{
+				return 0;
+			}
+
+			break;
+		}
+		//==================================================
+		case G_SET_CONFIGSTRING: // (int num, const char* string)
+		//==================================================
+		{
+			if (!Proxy_SharedAPI_SetConfigstring((int)args[0], (const char*)args[1]))
+			{
+				return 0;
+			}
+
+			break;
+		}
+		//==================================================
+		case G_DROP_CLIENT: // (int clientNum, const char* reason)
+		//==================================================
+		{
+			Proxy_SharedAPI_DropClient((int)args[0], (const char*)args[1]);
+
+			break;
+		}
+		//==================================================
+		case G_GET_CONFIGSTRING: // (int num, char* buffer, int bufferSize)
+		//==================================================
+		{
+			if (!Proxy_SharedAPI_GetConfigstring((int)args[0], (char*)args[1], (int)args[2]))
+			{
+				return 0;
+			}
+
+			break;
+		}
+		//==================================================
+		case BOTLIB_GET_SNAPSHOT_ENTITY: // (int clientNum, int sequence)
+		//==================================================
+		{
+			Proxy_SharedAPI_BotGetSnapshotEntity((int)args[0], (int)args[1]);
+
+			break;
+		}
+		//==================================================
+		case G_SET_SERVER_CULL: // (float cullDistance)
+		//==================================================
+		{
+			byteAlias_t cullDistance;
+
+			cullDistance.i = (int)args[0];
+
+			Proxy_SharedAPI_SetServerCull(cullDistance.f);
+
+			break;
+		}
 		default:
 			break;
 	}
@@ -21,6 +21,29 @@ void Proxy_Patch_Attach(void)
 	Original_Common_Com_Printf = (void (QDECL *)(const char* fmt, ...)) Attach((unsigned char*)func_Com_Printf_addr, (unsigned char*)&Proxy_Common_Com_Printf);
 	Original_SV_Status_f = (void (*)(void)) Attach((unsigned char*)func_SV_Status_f_addr, (unsigned char*)&Proxy_SV_Status_f);
 	Original_SV_SendClientGameState = (void (*)(client_t*)) Attach((unsigned char*)func_SV_SendClientGameState_addr, (unsigned char*)&Proxy_SV_SendClientGameState);
+	Original_MSG_WriteDeltaEntity = (void (*)(msg_t*, entityState_t*, entityState_t*, qboolean)) Attach((unsigned char*)func_MSG_WriteDeltaEntity_addr, (unsigned char*)&Proxy_MSG_WriteDeltaEntity);
+
+	// The Huffman tables are read from the engine functions, build them before these get detoured
+	if (Proxy_MSG_InitHuffman())
+	{
+		Original_MSG_WriteByte = (void (*)(msg_t*, int)) Attach((unsigned char*)func_MSG_WriteByte_addr, (unsigned char*)&Proxy_MSG_WriteByte);
+		Original_MSG_WriteShort = (void (*)(msg_t*, int)) Attach((unsigned char*)func_MSG_WriteShort_addr, (unsigned char*)&Proxy_MSG_WriteShort);
+		Original_MSG_WriteLong = (void (*)(msg_t*, int)) Attach((unsigned char*)func_MSG_WriteLong_addr, (unsigned char*)&Proxy_MSG_WriteLong);
+		Original_MSG_ReadByte = (int (*)(msg_t*)) Attach((unsigned char*)func_MSG_ReadByte_addr, (unsigned char*)&Proxy_MSG_ReadByte);
+
+		// Read from Original_MSG_WriteDeltaEntity, the engine function is already detoured
+		if (!Proxy_MSG_InitEntityFields())
+		{
+			proxy.trap->Print("----- Proxy: entityState_t fields don't match the engine, keeping the engine delta writer\n");
+		}
+	}
+	else
+	{
+		proxy.trap->Print("----- Proxy: Huffman tables don't match the engine, keeping the engine codec\n");
+	}
+
+	Proxy_Net_Attach();
+	Proxy_Snapshot_Attach();
 }
 
 // ==================================================
@@ -34,6 +57,10 @@ void Proxy_Patch_Attach(void)
 
 void Proxy_Patch_Detach(void)
 {
+	// Joins the network thread, it must be done before the library gets unloaded
+	Proxy_Net_Detach();
+	Proxy_Snapshot_Detach();
+
 	Detach((unsigned char*)func_SV_UserMove_addr, (unsigned char*)Original_SV_UserMove);
 	Detach((unsigned char*)func_SV_SendMessageToClient_addr, (unsigned char*)Original_SV_SendMessageToClient);
 	Detach((unsigned char*)func_SV_CalcPings_addr, (unsigned char*)Original_SV_CalcPings);
@@ -41,4 +68,13 @@ void Proxy_Patch_Detach(void)
 	Detach((unsigned char*)func_Com_Printf_addr, (unsigned char*)Original_Common_Com_Printf);
 	Detach((unsigned char*)func_SV_Status_f_addr, (unsigned char*)Original_SV_Status_f);
 	Detach((unsigned char*)func_SV_SendClientGameState_addr, (unsigned char*)Original_SV_SendClientGameState);
+	Detach((unsigned char*)func_MSG_WriteDeltaEntity_addr, (unsigned char*)Original_MSG_WriteDeltaEntity);
+
+	if (Original_MSG_WriteByte)
+	{
+		Detach((unsigned char*)func_MSG_WriteByte_addr, (unsigned char*)Original_MSG_WriteByte);
+		Detach((unsigned char*)func_MSG_WriteShort_addr, (unsigned char*)Original_MSG_WriteShort);
+		Detach((unsigned char*)func_MSG_WriteLong_addr, (unsigned char*)Original_MSG_WriteLong);
+		Detach((unsigned char*)func_MSG_ReadByte_addr, (unsigned char*)Original_MSG_ReadByte);
+	}
 }
\ No newline at end of file
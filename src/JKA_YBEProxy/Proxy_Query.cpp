@@ -0,0 +1,233 @@
+#include "Proxy_Header.hpp"
+
+// ==================================================
+// Query cache (proxy_sv_queryCache, proxy_sv_queryRate)
+// --------------------------------------------------
+// Every getstatus and getinfo makes the engine build the
+// serverinfo (and the player list) again. The first query
+// of each kind in a frame is answered by the engine and its
+// response is kept, the next ones of the frame get it back
+// with their own challenge without reaching the engine.
+// proxy_sv_queryRate limits the queries per second of an
+// address with a token bucket, the ones over it are dropped.
+// The packets come from the recvfrom of Proxy_Net.
+// ==================================================
+
+#ifndef _MSC_VER
+
+#include <netinet/in.h>
+
+#define QUERY_RESPONSE_SIZE		16384
+#define QUERY_CHALLENGE_SIZE	128
+#define QUERY_BUCKETS			4096	// power of 2
+
+typedef enum
+{
+	QUERY_STATUS,
+	QUERY_INFO,
+	QUERY_MAX
+} queryType_t;
+
+static const char* queryResponseNames[QUERY_MAX] = { "statusResponse", "infoResponse" };
+
+typedef struct queryResponse_s
+{
+	int		time;				// svs->time of the frame it was answered in
+	int		length;				// without the challenge
+	int		challengeOffset;
+	byte	data[QUERY_RESPONSE_SIZE];
+} queryResponse_t;
+
+static struct Query_s {
+	queryResponse_t	responses[QUERY_MAX];
+
+	// The engine answers the query before the next recvfrom
+	qboolean		capturing;
+	queryType_t		captureType;
+	char			captureChallenge[QUERY_CHALLENGE_SIZE];
+
+	proxyRateBucket_t	buckets[QUERY_BUCKETS];
+} query;
+
+/*
+==================
+Proxy_Query_Parse
+
+Same tokens as Cmd_TokenizeString, the challenge is left
+empty when the cached response can't be used with it
+==================
+*/
+static int Proxy_Query_Parse(const byte* data, int length, char* challenge, int challengeSize)
+{
+	const char* text = (const char*)data + 4;
+	const char* end = (const char*)data + length;
+	const char* start;
+	int type, challengeLength;
+
+	challenge[0] = '\0';
+
+	while (text < end && *text && *text <= ' ')
+	{
+		text++;
+	}
+
+	for (start = text; text < end && *text > ' '; text++)
+	{
+	}
+
+	if (text - start == 9 && !Q_stricmpn(start, "getstatus", 9))
+	{
+		type = QUERY_STATUS;
+	}
+	else if (text - start == 7 && !Q_stricmpn(start, "getinfo", 7))
+	{
+		type = QUERY_INFO;
+	}
+	else
+	{
+		return -1;
+	}
+
+	while (text < end && *text && *text <= ' ')
+	{
+		text++;
+	}
+
+	for (start = text; text < end && *text > ' '; text++)
+	{
+		// Quoted, a comment or refused by Info_SetValueForKey
+		if (*text == '"' || *text == '/' || *text == '\\' || *text == ';')
+		{
+			return type;
+		}
+	}
+
+	challengeLength = text - start;
+
+	while (text < end && *text && *text <= ' ')
+	{
+		text++;
+	}
+
+	if (!challengeLength || challengeLength >= challengeSize || (text < end && *text))
+	{
+		return type;
+	}
+
+	memcpy(challenge, start, challengeLength);
+	challenge[challengeLength] = '\0';
+
+	return type;
+}
+
+/*
+==================
+Proxy_Query_Packet
+
+Returns qtrue when the packet was answered or dropped,
+the engine doesn't get it then
+==================
+*/
+qboolean Proxy_Query_Packet(int socket, const void* data, int length, const struct sockaddr* from, socklen_t fromLength)
+{
+	char challenge[QUERY_CHALLENGE_SIZE];
+	byte packet[QUERY_RESPONSE_SIZE + QUERY_CHALLENGE_SIZE];
+	queryResponse_t* response;
+	int type, challengeLength;
+
+	if (length < 4 || *(const int32_t*)data != -1)
+	{
+		return qfalse;
+	}
+
+	type = Proxy_Query_Parse((const byte*)data, length, challenge, sizeof(challenge));
+
+	if (type < 0)
+	{
+		return qfalse;
+	}
+
+	if (proxy_sv_queryRate.integer > 0 && from->sa_family == AF_INET && !Proxy_Net_RateAllow(query.buckets, QUERY_BUCKETS, ((const struct sockaddr_in*)from)->sin_addr.s_addr, proxy_sv_queryRate.integer))
+	{
+		return qtrue;
+	}
+
+	if (!proxy_sv_queryCache.integer || !challenge[0])
+	{
+		return qfalse;
+	}
+
+	response = &query.responses[type];
+
+	if (!response->length || response->time != server.svs->time)
+	{
+		query.capturing = qtrue;
+		query.captureType = (queryType_t)type;
+		Q_strncpyz(query.captureChallenge, challenge, sizeof(query.captureChallenge));
+
+		return qfalse;
+	}
+
+	challengeLength = strlen(challenge);
+
+	memcpy(packet, response->data, response->challengeOffset);
+	memcpy(packet + response->challengeOffset, challenge, challengeLength);
+	memcpy(packet + response->challengeOffset + challengeLength, response->data + response->challengeOffset, response->length - response->challengeOffset);
+
+	Proxy_Net_SendPacket(socket, packet, response->length + challengeLength, from, fromLength);
+
+	return qtrue;
+}
+
+// Called from the sendto of Proxy_Net, keeps the response of the engine to the query it was given
+void Proxy_Query_Response(const void* data, int length)
+{
+	const char* text = (const char*)data;
+	const char* responseName;
+	char key[QUERY_CHALLENGE_SIZE + 16];
+	queryResponse_t* response;
+	int keyLength, i;
+
+	if (!query.capturing)
+	{
+		return;
+	}
+
+	query.capturing = qfalse;
+	response = &query.responses[query.captureType];
+	responseName = queryResponseNames[query.captureType];
+
+	if (length < 4 || length > QUERY_RESPONSE_SIZE || *(const int32_t*)data != -1 || strncmp(text + 4, responseName, strlen(responseName)))
+	{
+		return;
+	}
+
+	// Info_SetValueForKey appends it, it's the last one
+	keyLength = Com_sprintf(key, sizeof(key), "\\challenge\\%s", query.captureChallenge);
+
+	for (i = length - keyLength; i >= 4; i--)
+	{
+		if (!memcmp(text + i, key, keyLength) && (i + keyLength == length || text[i + keyLength] == '\\' || text[i + keyLength] == '\n' || !text[i + keyLength]))
+		{
+			break;
+		}
+	}
+
+	if (i < 4)
+	{
+		return;
+	}
+
+	response->challengeOffset = i + keyLength - strlen(query.captureChallenge);
+	response->length = length - strlen(query.captureChallenge);
+	memcpy(response->data, text, response->challengeOffset);
+	memcpy(response->data + response->challengeOffset, text + i + keyLength, length - i - keyLength);
+	response->time = server.svs->time;
+}
+
+void Proxy_Query_EndCapture(void)
+{
+	query.capturing = qfalse;
+}
+
+#endif
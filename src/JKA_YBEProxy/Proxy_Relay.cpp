@@ -0,0 +1,232 @@
+#include "Proxy_Header.hpp"
+
+// ==================================================
+// Spectator relay (proxy_sv_relaySlot, proxy_sv_relayPath)
+// --------------------------------------------------
+// The messages sent to the relay slot (gamestate and
+// snapshots, before the netchan encoding) are also sent
+// to a local relay process through a Unix datagram socket,
+// the relay fans them out to the viewers so they don't
+// take a client slot each on the server.
+// A datagram is a relayHeader_t followed by the message,
+// nothing is sent (and nothing blocks) while no relay
+// process is listening on proxy_sv_relayPath.
+// A message the relay didn't get (no relay listening, or
+// EAGAIN/ENOBUFS when it's too slow) breaks the delta
+// chain: the snapshots delta from a frame the relay doesn't
+// have aren't sent, and the relay slot is given a snapshot
+// without delta (at most every RELAY_KEYFRAME_INTERVAL)
+// so the relay gets a keyframe to start again from.
+// ==================================================
+
+#ifndef _MSC_VER
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+	#include <fcntl.h>
+	#include <errno.h>
+#endif
+
+#define RELAY_MAGIC				0x5942524C	// "YBRL"
+
+#define RELAY_MESSAGE_GAMESTATE	0
+#define RELAY_MESSAGE_SNAPSHOT	1
+
+#define RELAY_KEYFRAME_INTERVAL	500		// ms between two snapshots without delta forced on the relay slot
+
+typedef struct relayHeader_s
+{
+	int32_t		magic;
+	int32_t		type;
+	int32_t		sequence;		// netchan outgoingSequence of the message
+	int32_t		serverTime;
+	int32_t		clientNum;
+	int32_t		length;
+} relayHeader_t;
+
+#ifndef _MSC_VER
+static struct Relay_s {
+	int					socket;
+	struct sockaddr_un	address;
+	qboolean			warned;
+	int					clientNum;					// of the relayed messages
+	int					relayed[PACKET_BACKUP];		// sequence of the messages the relay got
+	int					keyframeTime;				// of the last snapshot without delta forced
+} relay = { -1 };
+
+static void Proxy_Relay_Reset(int clientNum)
+{
+	relay.clientNum = clientNum;
+	memset(relay.relayed, 0, sizeof(relay.relayed));
+}
+
+// Whether the relay has the frame the message is delta from
+static qboolean Proxy_Relay_HasDeltaFrame(client_t* client)
+{
+	if (client->state != CS_ACTIVE || client->deltaMessage <= 0)
+	{
+		return qtrue;
+	}
+
+	return (qboolean)(relay.relayed[client->deltaMessage & PACKET_MASK] == client->deltaMessage);
+}
+
+void Proxy_Relay_Close(void)
+{
+	if (relay.socket != -1)
+	{
+		close(relay.socket);
+		relay.socket = -1;
+	}
+}
+
+// Update function of proxy_sv_relayPath
+void Proxy_Relay_UpdatePath(void)
+{
+	Proxy_Relay_Close();
+
+	if (!proxy_sv_relayPath.string[0])
+	{
+		return;
+	}
+
+	if (strlen(proxy_sv_relayPath.string) >= sizeof(relay.address.sun_path))
+	{
+		proxy.trap->Print("----- Proxy: Relay: proxy_sv_relayPath is too long\n");
+
+		return;
+	}
+
+	relay.socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+
+	if (relay.socket == -1)
+	{
+		proxy.trap->Print("----- Proxy: Relay: can't create the socket (%s)\n", strerror(errno));
+
+		return;
+	}
+
+	fcntl(relay.socket, F_SETFL, fcntl(relay.socket, F_GETFL) | O_NONBLOCK);
+
+	memset(&relay.address, 0, sizeof(relay.address));
+	relay.address.sun_family = AF_UNIX;
+	Q_strncpyz(relay.address.sun_path, proxy_sv_relayPath.string, sizeof(relay.address.sun_path));
+
+	relay.warned = qfalse;
+	Proxy_Relay_Reset(-1);
+}
+
+// A snapshot without delta for the relay slot when the relay lost the frame it would be delta from
+void Proxy_Relay_RunFrame(void)
+{
+	client_t* client;
+
+	if (relay.socket == -1 || proxy_sv_relaySlot.integer < 0 || proxy_sv_relaySlot.integer >= server.cvars.sv_maxclients->integer)
+	{
+		return;
+	}
+
+	client = &server.svs->clients[proxy_sv_relaySlot.integer];
+
+	if (relay.clientNum != proxy_sv_relaySlot.integer)
+	{
+		Proxy_Relay_Reset(proxy_sv_relaySlot.integer);
+	}
+
+	if (Proxy_Relay_HasDeltaFrame(client)
+		|| (server.svs->time >= relay.keyframeTime && server.svs->time - relay.keyframeTime < RELAY_KEYFRAME_INTERVAL))
+	{
+		return;
+	}
+
+	client->deltaMessage = -1;
+	relay.keyframeTime = server.svs->time;
+}
+
+/*
+==================
+Proxy_Relay_Message
+
+Called from Proxy_SV_SendMessageToClient before the
+netchan encoding, a message to the relay slot which
+was just sent by SV_SendClientGameState is the gamestate
+==================
+*/
+void Proxy_Relay_Message(client_t* client, msg_t* msg)
+{
+	relayHeader_t header;
+	struct iovec iov[2];
+	struct msghdr message;
+	int clientNum = client - server.svs->clients;
+
+	if (relay.socket == -1 || clientNum != proxy_sv_relaySlot.integer)
+	{
+		return;
+	}
+
+	header.type = client->gamestateMessageNum == client->netchan.outgoingSequence ? RELAY_MESSAGE_GAMESTATE : RELAY_MESSAGE_SNAPSHOT;
+
+	// Nothing after it is delta from the messages before
+	if (relay.clientNum != clientNum || header.type == RELAY_MESSAGE_GAMESTATE)
+	{
+		Proxy_Relay_Reset(clientNum);
+	}
+
+	// The relay couldn't read it, Proxy_Relay_RunFrame gets it a keyframe
+	if (header.type == RELAY_MESSAGE_SNAPSHOT && !Proxy_Relay_HasDeltaFrame(client))
+	{
+		return;
+	}
+
+	header.magic = RELAY_MAGIC;
+	header.sequence = client->netchan.outgoingSequence;
+	header.serverTime = server.svs->time;
+	header.clientNum = clientNum;
+	header.length = msg->cursize;
+
+	iov[0].iov_base = &header;
+	iov[0].iov_len = sizeof(header);
+	iov[1].iov_base = msg->data;
+	iov[1].iov_len = msg->cursize;
+
+	memset(&message, 0, sizeof(message));
+	message.msg_name = &relay.address;
+	message.msg_namelen = sizeof(relay.address);
+	message.msg_iov = iov;
+	message.msg_iovlen = 2;
+
+	if (sendmsg(relay.socket, &message, MSG_DONTWAIT) == -1)
+	{
+		// No relay listening (yet) or it's too slow, the message is dropped
+		if (errno != ENOENT && errno != ECONNREFUSED && errno != EAGAIN && errno != EWOULDBLOCK && !relay.warned)
+		{
+			proxy.trap->Print("----- Proxy: Relay: can't send to %s (%s)\n", proxy_sv_relayPath.string, strerror(errno));
+			relay.warned = qtrue;
+		}
+
+		return;
+	}
+
+	relay.relayed[client->netchan.outgoingSequence & PACKET_MASK] = client->netchan.outgoingSequence;
+}
+#else
+void Proxy_Relay_Close(void)
+{
+}
+
+void Proxy_Relay_UpdatePath(void)
+{
+	if (proxy_sv_relayPath.string[0])
+	{
+		proxy.trap->Print("----- Proxy: Relay: not supported on this platform\n");
+	}
+}
+
+void Proxy_Relay_RunFrame(void)
+{
+}
+
+void Proxy_Relay_Message(client_t* client, msg_t* msg)
+{
+}
+#endif
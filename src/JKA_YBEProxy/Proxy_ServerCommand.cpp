@@ -0,0 +1,329 @@
+#include "Proxy_Header.hpp"
+
+// ==================================================
+// Server command coalescing (proxy_sv_coalesceCommands)
+// --------------------------------------------------
+// Each SendServerCommand takes a slot of the reliable
+// commands of every client it goes to until it's acked,
+// floods end in "reliable command overflow" drops.
+// The commands the game sends during its frame are queued
+// and go to the engine in the same order at the end of it:
+// - an exact duplicate of the last command queued to the
+//   same clients is dropped
+// - a cp replaces the queued cp to the same clients
+// - a print following a print to the same clients is
+//   appended to it
+// Nothing is dropped across a queued configstring, the
+// clients would see the commands before the change only.
+// The commands sent outside of the frame go straight to
+// the engine. The queue is flushed before a command or a
+// configstring goes straight to the engine during the frame
+// and before a client is dropped, so nothing is reordered.
+// ==================================================
+
+// ==================================================
+// Configstring coalescing (proxy_sv_coalesceConfigstrings)
+// --------------------------------------------------
+// Each configstring change is a cs command to every client.
+// The configstrings the game sets during its frame go in
+// the same queue, at the place of the last value set for
+// them, and only the last value is given to the engine if
+// it isn't the one it already has. GetConfigstring returns
+// the queued value meanwhile. Without command coalescing
+// the commands still go straight to the engine, after the
+// configstrings queued before them.
+// ==================================================
+
+#define SERVERCOMMAND_MAX_QUEUED	256
+#define SERVERCOMMAND_MAX_LENGTH	1022	// longer ones are ignored by the engine
+
+typedef struct queuedServerCommand_s
+{
+	int			clientNum;		// -1 for all, the index of a configstring
+	qboolean	configstring;
+	qboolean	dropped;
+	uint32_t	hash;
+	char		text[SERVERCOMMAND_MAX_LENGTH + 1];
+} queuedServerCommand_t;
+
+static struct ServerCommand_s {
+	qboolean				queueing;
+	int						numQueued;
+	queuedServerCommand_t	queued[SERVERCOMMAND_MAX_QUEUED];
+	int						queuedConfigstrings[MAX_CONFIGSTRINGS];	// queued + 1 of the value to set, 0 if none
+} serverCommand;
+
+uint32_t Proxy_ServerCommand_Hash(const char* text)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*text)
+	{
+		hash = (hash ^ (byte)*text++) * 16777619u;
+	}
+
+	return hash;
+}
+
+// The text between the quotes of a print, NULL when it can't be merged
+static const char* Proxy_ServerCommand_PrintText(const char* text, int* length)
+{
+	const char* start;
+	int len;
+
+	if (strncmp(text, "print \"", 7))
+	{
+		return NULL;
+	}
+
+	start = text + 7;
+	len = strlen(start);
+
+	// The engine doesn't need the closing quote
+	if (len && start[len - 1] == '"')
+	{
+		len--;
+	}
+
+	if (memchr(start, '"', len))
+	{
+		return NULL;
+	}
+
+	*length = len;
+
+	return start;
+}
+
+static qboolean Proxy_ServerCommand_MergePrint(queuedServerCommand_t* last, int clientNum, const char* text)
+{
+	const char* lastPrint;
+	const char* print;
+	int lastLength, length;
+
+	if (last->dropped || last->configstring || last->clientNum != clientNum)
+	{
+		return qfalse;
+	}
+
+	lastPrint = Proxy_ServerCommand_PrintText(last->text, &lastLength);
+	print = Proxy_ServerCommand_PrintText(text, &length);
+
+	if (!lastPrint || !print || 7 + lastLength + length + 1 > SERVERCOMMAND_MAX_LENGTH)
+	{
+		return qfalse;
+	}
+
+	memcpy(last->text + 7 + lastLength, print, length);
+	memcpy(last->text + 7 + lastLength + length, "\"", 2);
+	last->hash = Proxy_ServerCommand_Hash(last->text);
+
+	return qtrue;
+}
+
+void Proxy_ServerCommand_BeginFrame(void)
+{
+	serverCommand.queueing = (qboolean)(proxy_sv_coalesceCommands.integer || proxy_sv_coalesceConfigstrings.integer);
+}
+
+void Proxy_ServerCommand_Flush(void)
+{
+	int i;
+
+	for (i = 0; i < serverCommand.numQueued; i++)
+	{
+		queuedServerCommand_t* command = &serverCommand.queued[i];
+
+		if (command->dropped)
+		{
+			continue;
+		}
+
+		if (command->configstring)
+		{
+			serverCommand.queuedConfigstrings[command->clientNum] = 0;
+			proxy.trap->SetConfigstring(command->clientNum, command->text);
+			Proxy_Configstring_Set(command->clientNum, command->text);
+		}
+		else
+		{
+			proxy.trap->SendServerCommand(command->clientNum, command->text);
+		}
+	}
+
+	serverCommand.numQueued = 0;
+}
+
+static queuedServerCommand_t* Proxy_ServerCommand_Add(int clientNum, qboolean configstring, uint32_t hash, const char* text, size_t length)
+{
+	queuedServerCommand_t* command;
+
+	if (serverCommand.numQueued == SERVERCOMMAND_MAX_QUEUED)
+	{
+		Proxy_ServerCommand_Flush();
+	}
+
+	command = &serverCommand.queued[serverCommand.numQueued++];
+	command->clientNum = clientNum;
+	command->configstring = configstring;
+	command->dropped = qfalse;
+	command->hash = hash;
+	memcpy(command->text, text, length + 1);
+
+	return command;
+}
+
+void Proxy_ServerCommand_EndFrame(void)
+{
+	Proxy_ServerCommand_Flush();
+	serverCommand.queueing = qfalse;
+}
+
+/*
+==================
+Proxy_ServerCommand_Queue
+
+Returns qtrue when the command is taken (queued, merged
+or dropped), qfalse when it has to go to the engine now
+==================
+*/
+qboolean Proxy_ServerCommand_Queue(int clientNum, const char* text)
+{
+	queuedServerCommand_t* command;
+	qboolean centerPrint, lastCommand;
+	uint32_t hash;
+	size_t length;
+	int i;
+
+	if (!serverCommand.queueing)
+	{
+		return qfalse;
+	}
+
+	// It goes to the engine after what was queued before it
+	if (!proxy_sv_coalesceCommands.integer || !text || (length = strlen(text)) > SERVERCOMMAND_MAX_LENGTH)
+	{
+		Proxy_ServerCommand_Flush();
+
+		return qfalse;
+	}
+
+	hash = Proxy_ServerCommand_Hash(text);
+	centerPrint = (qboolean)!strncmp(text, "cp ", 3);
+	lastCommand = qtrue;
+
+	for (i = serverCommand.numQueued - 1; i >= 0; i--)
+	{
+		command = &serverCommand.queued[i];
+
+		if (command->dropped)
+		{
+			continue;
+		}
+
+		if (command->configstring)
+		{
+			break;
+		}
+
+		// Not sent to any of these clients
+		if (command->clientNum != clientNum && command->clientNum != -1 && clientNum != -1)
+		{
+			continue;
+		}
+
+		if (lastCommand && command->clientNum == clientNum && command->hash == hash && !strcmp(command->text, text))
+		{
+			return qtrue;
+		}
+
+		lastCommand = qfalse;
+
+		// Only the last centerprint would be seen
+		if (centerPrint && command->clientNum == clientNum && !strncmp(command->text, "cp ", 3))
+		{
+			command->dropped = qtrue;
+		}
+	}
+
+	if (serverCommand.numQueued && Proxy_ServerCommand_MergePrint(&serverCommand.queued[serverCommand.numQueued - 1], clientNum, text))
+	{
+		return qtrue;
+	}
+
+	Proxy_ServerCommand_Add(clientNum, qfalse, hash, text, length);
+
+	return qtrue;
+}
+
+/*
+==================
+Proxy_ServerCommand_QueueConfigstring
+
+Returns qtrue when the value is taken (queued or already
+set), qfalse when it has to go to the engine now
+==================
+*/
+qboolean Proxy_ServerCommand_QueueConfigstring(int index, const char* value)
+{
+	int queued;
+	size_t length;
+
+	if (!serverCommand.queueing)
+	{
+		return qfalse;
+	}
+
+	// Bad indexes are for the engine to report, after what was queued before
+	if (index < 0 || index >= MAX_CONFIGSTRINGS || !proxy_sv_coalesceConfigstrings.integer)
+	{
+		Proxy_ServerCommand_Flush();
+
+		return qfalse;
+	}
+
+	if (!value)
+	{
+		value = "";
+	}
+
+	length = strlen(value);
+	queued = serverCommand.queuedConfigstrings[index];
+
+	// Its place in the queue is the one of the last value
+	if (queued)
+	{
+		serverCommand.queued[queued - 1].dropped = qtrue;
+		serverCommand.queuedConfigstrings[index] = 0;
+	}
+
+	if (length > SERVERCOMMAND_MAX_LENGTH)
+	{
+		Proxy_ServerCommand_Flush();
+
+		return qfalse;
+	}
+
+	if (Proxy_Configstring_IsCurrent(index, value))
+	{
+		return qtrue;
+	}
+
+	Proxy_ServerCommand_Add(index, qtrue, 0, value, length);
+	serverCommand.queuedConfigstrings[index] = serverCommand.numQueued;
+
+	return qtrue;
+}
+
+// Returns qtrue when the buffer got the queued value of the configstring
+qboolean Proxy_ServerCommand_GetConfigstring(int index, char* buffer, int bufferSize)
+{
+	if (index < 0 || index >= MAX_CONFIGSTRINGS || !serverCommand.queuedConfigstrings[index] || bufferSize < 1)
+	{
+		return qfalse;
+	}
+
+	Q_strncpyz(buffer, serverCommand.queued[serverCommand.queuedConfigstrings[index] - 1].text, bufferSize);
+
+	return qtrue;
+}
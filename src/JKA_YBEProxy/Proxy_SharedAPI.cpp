@@ -21,6 +21,48 @@ void Proxy_SharedAPI_GetUsercmd(int clientNum, usercmd_t* cmd)
 	cmd->angles[ROLL] = 0;
 }
 
+// Returns qfalse when the command doesn't go to the engine now
+qboolean Proxy_SharedAPI_SendServerCommand(int clientNum, const char* text)
+{
+	return (qboolean)!Proxy_ServerCommand_Queue(clientNum, text);
+}
+
+// Returns qfalse when the configstring doesn't go to the engine now
+qboolean Proxy_SharedAPI_SetConfigstring(int num, const char* string)
+{
+	if (Proxy_ServerCommand_QueueConfigstring(num, string))
+	{
+		return qfalse;
+	}
+
+	// The engine has it right after
+	Proxy_Configstring_Set(num, string);
+
+	return qtrue;
+}
+
+// Returns qfalse when the buffer already got the value
+qboolean Proxy_SharedAPI_GetConfigstring(int num, char* buffer, int bufferSize)
+{
+	return (qboolean)!Proxy_ServerCommand_GetConfigstring(num, buffer, bufferSize);
+}
+
+void Proxy_SharedAPI_BotGetSnapshotEntity(int clientNum, int sequence)
+{
+	Proxy_Snapshot_BotSnapshotRead(clientNum);
+}
+
+// The disconnect goes to the client after what was queued before it
+void Proxy_SharedAPI_DropClient(int clientNum, const char* reason)
+{
+	Proxy_ServerCommand_Flush();
+}
+
+void Proxy_SharedAPI_SetServerCull(float cullDistance)
+{
+	proxy.snapshotData.serverCullEnabled = (qboolean)(cullDistance != -1.0f);
+}
+
 // ==================================================
 // EXPORT TABLE
 // ==================================================
@@ -56,6 +98,7 @@ qboolean Proxy_SharedAPI_ClientCommand(int clientNum)
 
 	if (!Q_stricmpn(cmd, "jkaDST_", 7))
 	{
+		Proxy_ServerCommand_Flush();
 		proxy.trap->SendServerCommand(-1, va("chat \"^3(Anti-Cheat system) ^7%s^3 got kicked cause of cheating^7\"", proxy.clientData[clientNum].cleanName));
 		proxy.trap->DropClient(clientNum, "(Anti-Cheat system) you got kicked cause of cheating");
 
@@ -151,6 +194,24 @@ void Proxy_SharedAPI_ClientThink(int clientNum, usercmd_t* ucmd)
 	}
 }
 
+void Proxy_SharedAPI_RunFrame(int levelTime)
+{
+	Proxy_ServerCommand_EndFrame();
+
+	Proxy_Cvar_Update();
+
+	// Only work on default engine since it require some memory hook
+	if (proxy.isDefaultEngine)
+	{
+		Proxy_Delta_UpdateDirtyEntities();
+		Proxy_Delta_ResetEncodings();
+		Proxy_Demo_RunFrame();
+		Proxy_Relay_RunFrame();
+		Proxy_Occlusion_RunFrame(levelTime);
+		Proxy_Snapshot_BeginFrame();
+	}
+}
+
 void Proxy_SharedAPI_ClientUserinfoChanged(int clientNum)
 {
 	char userinfo[MAX_INFO_STRING];
@@ -180,6 +241,7 @@ void Proxy_SharedAPI_ClientUserinfoChanged(int clientNum)
 
 		if (!Q_stricmpn(val, "darksidetools", len))
 		{
+			Proxy_ServerCommand_Flush();
 			proxy.trap->SendServerCommand(-1, va("chat \"^3(Anti-Cheat system) ^7%s^3 got kicked cause of cheating^7\"", proxy.clientData[clientNum].cleanName));
 			proxy.trap->DropClient(clientNum, "(Anti-Cheat system) you got kicked cause of cheating");
 		}
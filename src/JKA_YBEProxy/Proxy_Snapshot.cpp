@@ -0,0 +1,893 @@
+#include "Proxy_Header.hpp"
+#include "server/server.hpp"
+
+// ==================================================
+// Per-cluster visibility cache
+// --------------------------------------------------
+// SV_AddEntitiesVisibleFromPoint walks every entity and
+// tests it against the PVS of the viewer for each client
+// snapshot, while most of the clients stand in a few
+// clusters. The first snapshot built from a (cluster, area)
+// records the entities it accepted, the next snapshots
+// built from the same (cluster, area) during that frame
+// only test these entities, the others are rejected
+// through SV_SvEntityForGentity (Proxy_SV_SvEntityForGentity)
+// ==================================================
+
+// ==================================================
+// Exact view groups
+// --------------------------------------------------
+// Follow spectators see from the exact same point as the
+// followed player, the first snapshot built from a view
+// gives the entities of all the next snapshots from it,
+// even with a cull distance or portals.
+// Only the visible set is shared, each snapshot is still
+// encoded for its client (SV_WriteSnapshotToClient and the
+// playerState writer aren't mapped), the identical entity
+// deltas only share their bits with proxy_sv_deltaMemo.
+// ==================================================
+
+// Entities whose visibility depends on the viewer itself
+// and not only on its cluster, never rejected by the cache
+#define SNAPSHOT_VIEWER_DEPENDENT_FLAGS (SVF_BROADCAST | SVF_BROADCASTCLIENTS | SVF_SINGLECLIENT | SVF_NOTSINGLECLIENT)
+
+// ==================================================
+// Priority culling (proxy_sv_snapshotPriority)
+// --------------------------------------------------
+// A rate delayed client gets its snapshots late, all at
+// once. Instead, the entities of its last snapshot are
+// ranked by type, distance and time since they were last
+// sent, and the lowest ranked ones are left out of the
+// next snapshot until it fits the rate of the client.
+// Left out entities rank higher the next time.
+// The entities which didn't get dirty since they were last
+// sent to the client (Proxy_Delta_EntityChangeTime) aren't
+// ranked, the delta snapshot costs nothing for them and
+// leaving them out would cost a full state later.
+// ==================================================
+
+// ==================================================
+// Loss recovery (proxy_sv_snapshotRecovery)
+// --------------------------------------------------
+// After a loss burst the last acked snapshot of a client
+// is out of the PACKET_BACKUP window (of the client too,
+// it can't take an older delta base) and the engine sends
+// a full snapshot, the largest one at the worst moment.
+// Such a snapshot only keeps the best ranked entities of
+// the last one (up to proxy_sv_snapshotRecovery of them,
+// plus the ones never left out), the next snapshots are
+// deltas again and bring the others back.
+// ==================================================
+
+// ==================================================
+// Bot snapshots (proxy_sv_botSnapshots)
+// --------------------------------------------------
+// The engine builds a snapshot for each bot every frame,
+// nothing is sent and only the game reads it (through
+// BotGetSnapshotEntity), if it reads it at all.
+// 1: a bot gets its snapshots at the rate of its snaps,
+//    like a real client.
+// 2: also only once the game read the last one, a bot
+//    the game never asks about still gets one each
+//    SNAPSHOT_BOT_MAX_STALENESS msec.
+// ==================================================
+
+// ==================================================
+// Entity number sort (proxy_sv_snapshotSort)
+// --------------------------------------------------
+// SV_BuildClientSnapshot sorts the entity numbers of each
+// snapshot with qsort. The qsort of the engine goes
+// through its GOT like its network calls (Proxy_Net), a
+// snapshot entity list is sorted by setting its numbers
+// in a MAX_GENTITIES bitset and reading the set bits back
+// in order. Any other qsort, or a list with a duplicate
+// (an error of the engine), goes to the real qsort.
+// Linux only.
+// ==================================================
+
+#define SNAPSHOT_PRIORITY_MAX_STALENESS 1000
+#define SNAPSHOT_BOT_MAX_STALENESS		1000	// msec
+
+typedef struct snapshotPriority_s
+{
+	int		entityNum;
+	float	score;
+} snapshotPriority_t;
+
+// Puts off the snapshot of a bot with nextSnapshotTime, the engine never sets it for bots
+static void Proxy_Snapshot_ScheduleBot(int clientNum)
+{
+	client_t* client = &server.svs->clients[clientNum];
+	int due, staleness;
+
+	if (!proxy_sv_botSnapshots.integer || client->state != CS_ACTIVE || !client->gentity || !(client->gentity->r.svFlags & SVF_BOT))
+	{
+		return;
+	}
+
+	due = proxy.snapshotData.botSnapshotTime[clientNum] + client->snapshotMsec;
+	staleness = server.svs->time - proxy.snapshotData.botSnapshotTime[clientNum];
+
+	if (proxy_sv_botSnapshots.integer >= 2 && proxy.snapshotData.botSnapshotUnread[clientNum] && due <= server.svs->time
+		&& staleness >= 0 && staleness < SNAPSHOT_BOT_MAX_STALENESS)
+	{
+		due = server.svs->time + 1;
+	}
+
+	client->nextSnapshotTime = due;
+}
+
+/*
+==================
+Proxy_Snapshot_BeginFrame
+
+Called after the game module ran its frame, the client
+snapshots of this frame are going to be built right after
+==================
+*/
+void Proxy_Snapshot_BeginFrame(void)
+{
+	client_t* client;
+	int i;
+
+	proxy.snapshotData.frameSnapshotCounter = server.sv->snapshotCounter;
+	proxy.snapshotData.numScheduledClients = 0;
+	proxy.snapshotData.scheduleChecked = qfalse;
+	proxy.snapshotData.currentClientNum = -1;
+	proxy.snapshotData.hideEntities = qfalse;
+
+	// Same checks as SV_SendClientMessages, some of these clients
+	// can still be freed by SV_CheckTimeouts before their snapshot
+	for (i = 0, client = server.svs->clients; i < server.cvars.sv_maxclients->integer; i++, client++)
+	{
+		Proxy_Snapshot_ScheduleBot(i);
+
+		if (!client->state || server.svs->time < client->nextSnapshotTime || client->netchan.unsentFragments)
+		{
+			continue;
+		}
+
+		proxy.snapshotData.scheduledClients[proxy.snapshotData.numScheduledClients++] = i;
+	}
+
+	proxy.snapshotData.viewCacheTime = server.svs->time;
+	proxy.snapshotData.numViewCaches = 0;
+	proxy.snapshotData.currentViewCache = -1;
+	proxy.snapshotData.populateViewCache = -1;
+	proxy.snapshotData.viewCacheEnabled = qfalse;
+
+	proxy.snapshotData.numViewGroups = 0;
+	proxy.snapshotData.currentViewGroup = -1;
+	proxy.snapshotData.populateViewGroup = -1;
+
+	// Distance culling depends on the origin of the viewer
+	if (!proxy_sv_pvsCache.integer || proxy.snapshotData.serverCullEnabled)
+	{
+		return;
+	}
+
+	// Portals merge the PVS of another point depending on the distance to the viewer
+	for (i = 0; i < server.sv->num_entities; i++)
+	{
+		sharedEntity_t* ent = Proxy_GetEntityByNum(i);
+
+		if (ent->r.linked && (ent->r.svFlags & SVF_PORTAL))
+		{
+			return;
+		}
+	}
+
+	proxy.snapshotData.viewCacheEnabled = qtrue;
+}
+
+// Store the entities accepted by the snapshot which was populating a cache,
+// SV_AddEntitiesVisibleFromPoint marks them with the counter of that snapshot
+static void Proxy_Snapshot_StoreVisibleEntities(uint32_t* visibleEntities)
+{
+	int i;
+
+	memset(visibleEntities, 0, (MAX_GENTITIES / 32) * sizeof(uint32_t));
+
+	for (i = 0; i < server.sv->num_entities; i++)
+	{
+		if (server.sv->svEntities[i].snapshotCounter == proxy.snapshotData.populateSnapshotCounter)
+		{
+			visibleEntities[i >> 5] |= (1U << (i & 31));
+		}
+	}
+}
+
+// Find the entity the snapshot is built for, SV_BuildClientSnapshot
+// marks it (never sent to itself) before adding the visible entities
+static int Proxy_Snapshot_FindViewEntity(int snapshotCounter)
+{
+	int i;
+
+	for (i = 0; i < server.cvars.sv_maxclients->integer; i++)
+	{
+		if (server.sv->svEntities[i].snapshotCounter == snapshotCounter)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+// Find the client of the snapshot being built from the order of SV_SendClientMessages
+static int Proxy_Snapshot_FindClient(int viewEntityNum)
+{
+	client_t* client;
+	int clientNum;
+	int index;
+	int i;
+
+	if (!proxy.snapshotData.scheduleChecked)
+	{
+		int numScheduledClients = 0;
+
+		for (i = 0; i < proxy.snapshotData.numScheduledClients; i++)
+		{
+			if (server.svs->clients[proxy.snapshotData.scheduledClients[i]].state != CS_FREE)
+			{
+				proxy.snapshotData.scheduledClients[numScheduledClients++] = proxy.snapshotData.scheduledClients[i];
+			}
+		}
+
+		proxy.snapshotData.numScheduledClients = numScheduledClients;
+		proxy.snapshotData.scheduleChecked = qtrue;
+	}
+
+	index = server.sv->snapshotCounter - proxy.snapshotData.frameSnapshotCounter - 1;
+
+	if (index < 0 || index >= proxy.snapshotData.numScheduledClients)
+	{
+		return -1;
+	}
+
+	clientNum = proxy.snapshotData.scheduledClients[index];
+	client = &server.svs->clients[clientNum];
+
+	// The view entity has to match or the order is wrong
+	if (client->state == CS_FREE || !client->gentity || Proxy_GetPlayerStateByClientNum(clientNum)->clientNum != viewEntityNum)
+	{
+		return -1;
+	}
+
+	return clientNum;
+}
+
+// 0 for the entities which are never left out
+static int Proxy_Snapshot_EntityWeight(sharedEntity_t* ent)
+{
+	// Events would be lost
+	if (ent->s.eType >= ET_EVENTS || ent->s.event || (ent->r.svFlags & SVF_BROADCAST))
+	{
+		return 0;
+	}
+
+	switch (ent->s.eType)
+	{
+		// What matters the most
+		case ET_PLAYER:
+		case ET_NPC:
+		// Used by the prediction of the client
+		case ET_MOVER:
+		case ET_PUSH_TRIGGER:
+		case ET_TELEPORT_TRIGGER:
+		case ET_TEAM:
+			return 0;
+		case ET_MISSILE:
+		case ET_SPECIAL:
+			return 4;
+		case ET_ITEM:
+		case ET_HOLOCRON:
+			return 2;
+		default:
+			return 1;
+	}
+}
+
+static int Proxy_Snapshot_ComparePriority(const void* a, const void* b)
+{
+	const snapshotPriority_t* pa = (const snapshotPriority_t*)a;
+	const snapshotPriority_t* pb = (const snapshotPriority_t*)b;
+
+	if (pa->score < pb->score)
+	{
+		return -1;
+	}
+
+	if (pa->score > pb->score)
+	{
+		return 1;
+	}
+
+	return pa->entityNum - pb->entityNum;
+}
+
+static void Proxy_Snapshot_HideEntity(int entityNum)
+{
+	if (!proxy.snapshotData.hideEntities)
+	{
+		memset(proxy.snapshotData.hiddenEntities, 0, sizeof(proxy.snapshotData.hiddenEntities));
+		proxy.snapshotData.hideEntities = qtrue;
+	}
+
+	proxy.snapshotData.hiddenEntities[entityNum >> 5] |= (1U << (entityNum & 31));
+}
+
+/*
+==================
+Proxy_Snapshot_RankEntities
+
+The entities of a snapshot which can be left out, the
+lowest ranked first, only the ones which changed since
+they were last sent if changedOnly
+==================
+*/
+static int Proxy_Snapshot_RankEntities(int clientNum, clientSnapshot_t* frame, qboolean changedOnly, snapshotPriority_t* candidates)
+{
+	client_t* client = &server.svs->clients[clientNum];
+	playerState_t* ps = Proxy_GetPlayerStateByClientNum(clientNum);
+	int numCandidates = 0;
+	int i;
+
+	for (i = 0; i < frame->num_entities && numCandidates < MAX_SNAPSHOT_ENTITIES; i++)
+	{
+		int entityNum = server.svs->snapshotEntities[(frame->first_entity + i) % server.svs->numSnapshotEntities].number;
+		sharedEntity_t* ent = Proxy_GetEntityByNum(entityNum);
+		int weight = Proxy_Snapshot_EntityWeight(ent);
+		int staleness;
+		vec3_t center;
+
+		if (!weight)
+		{
+			continue;
+		}
+
+		if (changedOnly && Proxy_Delta_EntityChangeTime(entityNum) <= proxy.clientData[clientNum].lastSnapshotTime[entityNum])
+		{
+			continue;
+		}
+
+		// Brush models have no origin
+		VectorAdd(ent->r.absmin, ent->r.absmax, center);
+		VectorScale(center, 0.5f, center);
+
+		staleness = server.svs->time - proxy.clientData[clientNum].lastSnapshotTime[entityNum];
+
+		if (staleness < 0 || staleness > SNAPSHOT_PRIORITY_MAX_STALENESS)
+		{
+			staleness = SNAPSHOT_PRIORITY_MAX_STALENESS;
+		}
+
+		candidates[numCandidates].entityNum = entityNum;
+		candidates[numCandidates].score = weight * (float)(client->snapshotMsec + staleness) / (Distance(ps->origin, center) + 128.0f);
+		numCandidates++;
+	}
+
+	qsort(candidates, numCandidates, sizeof(candidates[0]), Proxy_Snapshot_ComparePriority);
+
+	return numCandidates;
+}
+
+static void Proxy_Snapshot_SelectPriorityEntities(int clientNum)
+{
+	client_t* client = &server.svs->clients[clientNum];
+	clientSnapshot_t* lastFrame;
+	snapshotPriority_t candidates[MAX_SNAPSHOT_ENTITIES];
+	int numCandidates;
+	int numHidden;
+	int rateMsec;
+	int i;
+
+	if (!proxy_sv_snapshotPriority.integer || !client->rateDelayed || client->state != CS_ACTIVE || (client->gentity->r.svFlags & SVF_BOT))
+	{
+		return;
+	}
+
+	lastFrame = &client->frames[(client->netchan.outgoingSequence - 1) & PACKET_MASK];
+
+	if (lastFrame->num_entities <= 0 || lastFrame->messageSize <= 0)
+	{
+		return;
+	}
+
+	rateMsec = server.functions.SV_RateMsec(client, lastFrame->messageSize);
+
+	if (rateMsec <= client->snapshotMsec)
+	{
+		return;
+	}
+
+	numCandidates = Proxy_Snapshot_RankEntities(clientNum, lastFrame, qtrue, candidates);
+
+	// Changed entities that would fit, supposing they all cost the same
+	numHidden = numCandidates - (numCandidates * client->snapshotMsec) / rateMsec;
+
+	for (i = 0; i < numHidden; i++)
+	{
+		Proxy_Snapshot_HideEntity(candidates[i].entityNum);
+	}
+}
+
+// Same checks as SV_WriteSnapshotToClient, the snapshot being built is sent without delta
+static qboolean Proxy_Snapshot_IsNonDelta(client_t* client)
+{
+	if (client->deltaMessage <= 0 || client->state != CS_ACTIVE)
+	{
+		return qtrue;
+	}
+
+	if (client->netchan.outgoingSequence - client->deltaMessage >= (PACKET_BACKUP - 3))
+	{
+		return qtrue;
+	}
+
+	return (qboolean)(client->frames[client->deltaMessage & PACKET_MASK].first_entity <= server.svs->nextSnapshotEntities - server.svs->numSnapshotEntities);
+}
+
+static void Proxy_Snapshot_SelectRecoveryEntities(int clientNum)
+{
+	client_t* client = &server.svs->clients[clientNum];
+	clientSnapshot_t* lastFrame;
+	snapshotPriority_t candidates[MAX_SNAPSHOT_ENTITIES];
+	int numCandidates;
+	int i;
+
+	if (proxy_sv_snapshotRecovery.integer <= 0 || client->state != CS_ACTIVE || (client->gentity->r.svFlags & SVF_BOT) || !Proxy_Snapshot_IsNonDelta(client))
+	{
+		return;
+	}
+
+	lastFrame = &client->frames[(client->netchan.outgoingSequence - 1) & PACKET_MASK];
+
+	// Also true for the first snapshot after the gamestate, it has nothing to rank
+	if (lastFrame->num_entities <= proxy_sv_snapshotRecovery.integer)
+	{
+		return;
+	}
+
+	// The snapshot is sent without delta, every entity costs its full state
+	numCandidates = Proxy_Snapshot_RankEntities(clientNum, lastFrame, qfalse, candidates);
+
+	for (i = 0; i < numCandidates - proxy_sv_snapshotRecovery.integer; i++)
+	{
+		Proxy_Snapshot_HideEntity(candidates[i].entityNum);
+	}
+}
+
+// Occluded enemies are seen from the view entity, follow spectators get what the followed player gets
+static void Proxy_Snapshot_SelectOccludedEntities(int viewEntityNum)
+{
+	int i;
+
+	if (!proxy_sv_antiWallhack.integer)
+	{
+		return;
+	}
+
+	for (i = 0; i < server.cvars.sv_maxclients->integer; i++)
+	{
+		if (Proxy_Occlusion_IsHidden(viewEntityNum, i))
+		{
+			Proxy_Snapshot_HideEntity(i);
+		}
+	}
+}
+
+// What SV_BuildClientSnapshot uses to find the visible entities
+static qboolean Proxy_Snapshot_SameView(const playerState_t* a, const playerState_t* b)
+{
+	return (qboolean)(a->clientNum == b->clientNum
+		&& !memcmp(a->origin, b->origin, sizeof(a->origin))
+		&& a->viewheight == b->viewheight
+		&& a->m_iVehicleNum == b->m_iVehicleNum);
+}
+
+static void Proxy_Snapshot_SelectViewGroup(int clientNum)
+{
+	playerState_t* ps = Proxy_GetPlayerStateByClientNum(clientNum);
+	snapshotViewGroup_t* viewGroup = NULL;
+	int i;
+
+	for (i = 0; i < proxy.snapshotData.numViewGroups; i++)
+	{
+		viewGroup = &proxy.snapshotData.viewGroups[i];
+
+		if (Proxy_Snapshot_SameView(ps, Proxy_GetPlayerStateByClientNum(viewGroup->clientNum)))
+		{
+			break;
+		}
+	}
+
+	if (i == proxy.snapshotData.numViewGroups)
+	{
+		if (proxy.snapshotData.numViewGroups >= MAX_CLIENTS)
+		{
+			return;
+		}
+
+		viewGroup = &proxy.snapshotData.viewGroups[proxy.snapshotData.numViewGroups++];
+		viewGroup->clientNum = clientNum;
+		viewGroup->populated = qfalse;
+	}
+
+	if (viewGroup->populated)
+	{
+		proxy.snapshotData.currentViewGroup = i;
+	}
+	// Hidden entities would be missing for the next clients
+	else if (!proxy.snapshotData.hideEntities)
+	{
+		proxy.snapshotData.populateViewGroup = i;
+		proxy.snapshotData.populateSnapshotCounter = server.sv->snapshotCounter;
+	}
+}
+
+static void Proxy_Snapshot_SelectViewCache(int viewEntityNum)
+{
+	sharedEntity_t* viewEnt = Proxy_GetEntityByNum(viewEntityNum);
+	svEntity_t* svViewEnt = &server.sv->svEntities[viewEntityNum];
+	playerState_t* ps = Proxy_GetPlayerStateByClientNum(viewEntityNum);
+	snapshotViewCache_t* viewCache = NULL;
+	vec3_t eye;
+	int i;
+
+	// The view entity has to be in a single cluster and area,
+	// the eye inside of its bounds is then in these too
+	if (!viewEnt->r.linked || svViewEnt->numClusters != 1 || svViewEnt->areanum == -1 || svViewEnt->areanum2 != -1)
+	{
+		return;
+	}
+
+	VectorCopy(ps->origin, eye);
+	eye[2] += ps->viewheight;
+
+	for (i = 0; i < 3; i++)
+	{
+		if (eye[i] < viewEnt->r.absmin[i] || eye[i] > viewEnt->r.absmax[i])
+		{
+			return;
+		}
+	}
+
+	// An eye inside of a wall doesn't see from the cluster of the entity
+	if (proxy.trap->PointContents(eye, ENTITYNUM_NONE) & CONTENTS_SOLID)
+	{
+		return;
+	}
+
+	for (i = 0; i < proxy.snapshotData.numViewCaches; i++)
+	{
+		viewCache = &proxy.snapshotData.viewCaches[i];
+
+		if (viewCache->cluster == svViewEnt->clusternums[0] && viewCache->area == svViewEnt->areanum)
+		{
+			break;
+		}
+	}
+
+	if (i == proxy.snapshotData.numViewCaches)
+	{
+		if (proxy.snapshotData.numViewCaches >= MAX_CLIENTS)
+		{
+			return;
+		}
+
+		viewCache = &proxy.snapshotData.viewCaches[proxy.snapshotData.numViewCaches++];
+		viewCache->cluster = svViewEnt->clusternums[0];
+		viewCache->area = svViewEnt->areanum;
+		viewCache->populated = qfalse;
+	}
+
+	if (viewCache->populated)
+	{
+		proxy.snapshotData.currentViewCache = i;
+	}
+	// Hidden entities would be missing for the next clients
+	else if (!proxy.snapshotData.hideEntities)
+	{
+		proxy.snapshotData.populateViewCache = i;
+		proxy.snapshotData.populateSnapshotCounter = server.sv->snapshotCounter;
+	}
+}
+
+// First SV_SvEntityForGentity call since sv.snapshotCounter changed
+static void Proxy_Snapshot_BeginClientSnapshot(void* returnAddress)
+{
+	int viewEntityNum;
+
+	if (proxy.snapshotData.populateViewCache != -1)
+	{
+		snapshotViewCache_t* viewCache = &proxy.snapshotData.viewCaches[proxy.snapshotData.populateViewCache];
+
+		Proxy_Snapshot_StoreVisibleEntities(viewCache->visibleEntities);
+		viewCache->populated = qtrue;
+	}
+
+	if (proxy.snapshotData.populateViewGroup != -1)
+	{
+		snapshotViewGroup_t* viewGroup = &proxy.snapshotData.viewGroups[proxy.snapshotData.populateViewGroup];
+
+		Proxy_Snapshot_StoreVisibleEntities(viewGroup->visibleEntities);
+		viewGroup->populated = qtrue;
+	}
+
+	proxy.snapshotData.currentViewCache = -1;
+	proxy.snapshotData.populateViewCache = -1;
+	proxy.snapshotData.currentViewGroup = -1;
+	proxy.snapshotData.populateViewGroup = -1;
+	proxy.snapshotData.currentClientNum = -1;
+	proxy.snapshotData.hideEntities = qfalse;
+
+	viewEntityNum = Proxy_Snapshot_FindViewEntity(server.sv->snapshotCounter);
+
+	// Not a snapshot (zombie client or entity linked after the last snapshot)
+	if (viewEntityNum == -1)
+	{
+		return;
+	}
+
+	// The call site is only trusted once two snapshots agreed on it
+	if (!proxy.snapshotData.snapshotCallSite)
+	{
+		if (proxy.snapshotData.candidateCallSite == returnAddress)
+		{
+			proxy.snapshotData.snapshotCallSite = returnAddress;
+		}
+		else
+		{
+			proxy.snapshotData.candidateCallSite = returnAddress;
+		}
+
+		return;
+	}
+
+	if (returnAddress != proxy.snapshotData.snapshotCallSite)
+	{
+		return;
+	}
+
+	// No frame ran since the last snapshots
+	if (proxy.snapshotData.viewCacheTime != server.svs->time)
+	{
+		return;
+	}
+
+	proxy.snapshotData.currentClientNum = Proxy_Snapshot_FindClient(viewEntityNum);
+
+	if (proxy.snapshotData.currentClientNum != -1 && (server.svs->clients[proxy.snapshotData.currentClientNum].gentity->r.svFlags & SVF_BOT))
+	{
+		proxy.snapshotData.botSnapshotTime[proxy.snapshotData.currentClientNum] = server.svs->time;
+		proxy.snapshotData.botSnapshotUnread[proxy.snapshotData.currentClientNum] = qtrue;
+	}
+
+	Proxy_Snapshot_SelectOccludedEntities(viewEntityNum);
+
+	if (proxy.snapshotData.currentClientNum != -1)
+	{
+		Proxy_Snapshot_SelectPriorityEntities(proxy.snapshotData.currentClientNum);
+		Proxy_Snapshot_SelectRecoveryEntities(proxy.snapshotData.currentClientNum);
+
+		if (proxy_sv_pvsCache.integer)
+		{
+			Proxy_Snapshot_SelectViewGroup(proxy.snapshotData.currentClientNum);
+		}
+	}
+
+	// An exact view gives a smaller set than the cluster
+	if (proxy.snapshotData.viewCacheEnabled && proxy.snapshotData.currentViewGroup == -1)
+	{
+		Proxy_Snapshot_SelectViewCache(viewEntityNum);
+	}
+}
+
+/*
+==================
+Proxy_Snapshot_FilterEntity
+
+Called from Proxy_SV_SvEntityForGentity, returns a svEntity_t
+already marked for this snapshot when the entity isn't visible
+from the cluster of the viewer or is left out because of the
+rate of the client, so the engine skips it
+==================
+*/
+svEntity_t* Proxy_Snapshot_FilterEntity(sharedEntity_t* gEnt, svEntity_t* svEnt, void* returnAddress)
+{
+	int entityNum;
+
+	if (server.sv->snapshotCounter != proxy.snapshotData.lastSnapshotCounter)
+	{
+		proxy.snapshotData.lastSnapshotCounter = server.sv->snapshotCounter;
+
+		Proxy_Snapshot_BeginClientSnapshot(returnAddress);
+	}
+
+	if (returnAddress != proxy.snapshotData.snapshotCallSite)
+	{
+		return svEnt;
+	}
+
+	entityNum = svEnt - server.sv->svEntities;
+
+	if (proxy.snapshotData.hideEntities && (proxy.snapshotData.hiddenEntities[entityNum >> 5] & (1U << (entityNum & 31))))
+	{
+		proxy.snapshotData.skippedEntity.snapshotCounter = server.sv->snapshotCounter;
+
+		return &proxy.snapshotData.skippedEntity;
+	}
+
+	if (proxy.snapshotData.currentViewGroup != -1 && !(gEnt->r.svFlags & SNAPSHOT_VIEWER_DEPENDENT_FLAGS)
+		&& !(proxy.snapshotData.viewGroups[proxy.snapshotData.currentViewGroup].visibleEntities[entityNum >> 5] & (1U << (entityNum & 31))))
+	{
+		proxy.snapshotData.skippedEntity.snapshotCounter = server.sv->snapshotCounter;
+
+		return &proxy.snapshotData.skippedEntity;
+	}
+
+	if (proxy.snapshotData.currentViewCache != -1 && !(gEnt->r.svFlags & SNAPSHOT_VIEWER_DEPENDENT_FLAGS)
+		&& !(proxy.snapshotData.viewCaches[proxy.snapshotData.currentViewCache].visibleEntities[entityNum >> 5] & (1U << (entityNum & 31))))
+	{
+		proxy.snapshotData.skippedEntity.snapshotCounter = server.sv->snapshotCounter;
+
+		return &proxy.snapshotData.skippedEntity;
+	}
+
+	return svEnt;
+}
+
+/*
+==================
+Proxy_Snapshot_MessageSent
+
+Called from Proxy_SV_SendMessageToClient before the
+transmission, records when the entities were last sent
+==================
+*/
+void Proxy_Snapshot_MessageSent(client_t* client)
+{
+	clientSnapshot_t* frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+	int clientNum = client - server.svs->clients;
+	int i;
+
+	if ((!proxy_sv_snapshotPriority.integer && proxy_sv_snapshotRecovery.integer <= 0) || client->state != CS_ACTIVE)
+	{
+		return;
+	}
+
+	for (i = 0; i < frame->num_entities; i++)
+	{
+		int entityNum = server.svs->snapshotEntities[(frame->first_entity + i) % server.svs->numSnapshotEntities].number;
+
+		proxy.clientData[clientNum].lastSnapshotTime[entityNum] = server.svs->time;
+	}
+}
+
+// The game read the snapshot of a bot (BotGetSnapshotEntity)
+void Proxy_Snapshot_BotSnapshotRead(int clientNum)
+{
+	if (clientNum >= 0 && clientNum < MAX_CLIENTS)
+	{
+		proxy.snapshotData.botSnapshotUnread[clientNum] = qfalse;
+	}
+}
+
+#ifndef _MSC_VER
+typedef void (*qsortFuncPtr_t)(void*, size_t, size_t, int (*)(const void*, const void*));
+
+static struct SnapshotSort_s {
+	qsortFuncPtr_t*	qsortEntry;
+	qsortFuncPtr_t	originalQsort;
+	void*			sortCallSite;		// qsort call from SV_BuildClientSnapshot
+	void*			candidateCallSite;
+} snapshotSort;
+
+// Entity numbers just added to the snapshot being built, marked by SV_AddEntToSnapshot
+static qboolean Proxy_Snapshot_IsEntityList(const int* entityNums, size_t count, uint32_t* entities)
+{
+	size_t i;
+
+	if (proxy.snapshotData.lastSnapshotCounter != server.sv->snapshotCounter || count > MAX_SNAPSHOT_ENTITIES)
+	{
+		return qfalse;
+	}
+
+	memset(entities, 0, (MAX_GENTITIES / 32) * sizeof(uint32_t));
+
+	for (i = 0; i < count; i++)
+	{
+		int entityNum = entityNums[i];
+
+		if (entityNum < 0 || entityNum >= MAX_GENTITIES || server.sv->svEntities[entityNum].snapshotCounter != server.sv->snapshotCounter)
+		{
+			return qfalse;
+		}
+
+		// A duplicate is reported by the comparison function of the engine
+		if (entities[entityNum >> 5] & (1U << (entityNum & 31)))
+		{
+			return qfalse;
+		}
+
+		entities[entityNum >> 5] |= (1U << (entityNum & 31));
+	}
+
+	return qtrue;
+}
+
+static void Proxy_Snapshot_Qsort(void* base, size_t count, size_t size, int (*compare)(const void*, const void*))
+{
+	void* returnAddress = YBEProxy_ReturnAddress();
+	uint32_t entities[MAX_GENTITIES / 32];
+	int* entityNums = (int*)base;
+	int i, numEntities = 0;
+
+	if (!proxy_sv_snapshotSort.integer || size != sizeof(int) || !Proxy_Snapshot_IsEntityList(entityNums, count, entities))
+	{
+		snapshotSort.originalQsort(base, count, size, compare);
+		return;
+	}
+
+	// The call site is only trusted once two snapshots agreed on it
+	if (returnAddress != snapshotSort.sortCallSite)
+	{
+		if (!snapshotSort.sortCallSite && returnAddress == snapshotSort.candidateCallSite)
+		{
+			snapshotSort.sortCallSite = returnAddress;
+		}
+		else
+		{
+			snapshotSort.candidateCallSite = returnAddress;
+		}
+
+		snapshotSort.originalQsort(base, count, size, compare);
+		return;
+	}
+
+	for (i = 0; i < MAX_GENTITIES / 32; i++)
+	{
+		uint32_t bits = entities[i];
+
+		while (bits)
+		{
+			entityNums[numEntities++] = (i << 5) + __builtin_ctz(bits);
+			bits &= bits - 1;
+		}
+	}
+}
+
+void Proxy_Snapshot_Attach(void)
+{
+	snapshotSort.qsortEntry = (qsortFuncPtr_t*)Proxy_Net_FindGotEntry("qsort");
+
+	if (!snapshotSort.qsortEntry)
+	{
+		proxy.trap->Print("----- Proxy: qsort not found in the engine, snapshot entity sort unavailable\n");
+
+		return;
+	}
+
+	// The GOT may still point to the resolver, call libc directly
+	snapshotSort.originalQsort = qsort;
+
+	Proxy_Net_SetGotEntry((void**)snapshotSort.qsortEntry, (void*)Proxy_Snapshot_Qsort);
+}
+
+void Proxy_Snapshot_Detach(void)
+{
+	if (snapshotSort.qsortEntry)
+	{
+		Proxy_Net_SetGotEntry((void**)snapshotSort.qsortEntry, (void*)snapshotSort.originalQsort);
+	}
+}
+#else
+void Proxy_Snapshot_Attach(void)
+{
+}
+
+void Proxy_Snapshot_Detach(void)
+{
+}
+#endif
@@ -0,0 +1,44 @@
+// ==================================================
+// Proxy cvars
+// --------------------------------------------------
+// Same layout as game/g_xcvar.hpp, include it with
+// XCVAR_PROTO, XCVAR_DECL or XCVAR_LIST defined.
+// ==================================================
+
+#ifdef XCVAR_PROTO
+	#define XCVAR_DEF( name, defVal, update, flags ) extern vmCvar_t name;
+#endif
+
+#ifdef XCVAR_DECL
+	#define XCVAR_DEF( name, defVal, update, flags ) vmCvar_t name;
+#endif
+
+#ifdef XCVAR_LIST
+	#define XCVAR_DEF( name, defVal, update, flags ) { & name , #name , defVal , update , flags },
+#endif
+
+XCVAR_DEF( proxy_sv_antiWallhack,		"0",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_antiWallhackTraces,	"256",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_botSnapshots,		"0",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_challengeHash,		"1",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_coalesceCommands,	"1",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_coalesceConfigstrings,	"1",		NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_deltaMemo,			"1",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_fastHuffman,		"1",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_filter,				"1",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_filterFile,			"",				Proxy_Filter_Load,	CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_filterRate,			"0",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_netBatch,			"0",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_netSendThread,		"0",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_netThread,			"0",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_pvsCache,			"0",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_queryCache,		"1",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_queryRate,			"0",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_relayPath,			"",				Proxy_Relay_UpdatePath,	CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_relaySlot,			"-1",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_snapshotPacing,		"0",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_snapshotPriority,	"0",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_snapshotRecovery,	"0",			NULL,				CVAR_ARCHIVE )
+XCVAR_DEF( proxy_sv_snapshotSort,		"0",			NULL,				CVAR_ARCHIVE )
+
+#undef XCVAR_DEF
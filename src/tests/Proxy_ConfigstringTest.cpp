@@ -0,0 +1,253 @@
+// ==================================================
+// Interned configstrings test
+// --------------------------------------------------
+// The configstrings of Proxy_Configstring.cpp set through
+// the coalescing queue of Proxy_ServerCommand.cpp to a
+// made up engine: the values skipped as already set, the
+// compaction of the arena, and the gamestate codes of the
+// values compared with the MSG_WriteBigString of the
+// native msg writer at every bit offset.
+// ==================================================
+
+#include "JKA_YBEProxy/EnginePatch/Proxy_EnginePatch.hpp"
+
+#include <stdio.h>
+
+#define TEST_BUFFER_SIZE	(BIG_INFO_STRING * 4 + 64)
+
+static int numFailures;
+
+#define TEST_CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			numFailures++; \
+		} \
+	} while (0)
+
+// What the tested files use from the rest of the proxy
+Proxy_t proxy;
+ProxyServer_t server;
+vmCvar_t proxy_sv_fastHuffman;
+vmCvar_t proxy_sv_coalesceCommands;
+vmCvar_t proxy_sv_coalesceConfigstrings;
+
+static gameImport_t testTrap;
+static server_t testServer;
+static char* engineConfigstrings[MAX_CONFIGSTRINGS];
+static int numEngineSets;
+
+// Proxy_Imports.cpp needs the engine, the queue only uses this one
+void Q_strncpyz(char* dest, const char* src, size_t destsize)
+{
+	strncpy(dest, src, destsize - 1);
+	dest[destsize - 1] = '\0';
+}
+
+// SV_SetConfigstring, with its own copy of the value
+static void Test_SetConfigstring(int num, const char* string)
+{
+	if (engineConfigstrings[num] && !strcmp(engineConfigstrings[num], string))
+	{
+		return;
+	}
+
+	free(engineConfigstrings[num]);
+	engineConfigstrings[num] = strdup(string);
+	testServer.configstrings[num] = engineConfigstrings[num];
+	numEngineSets++;
+}
+
+static void Test_SendServerCommand(int clientNum, const char* text)
+{
+}
+
+static void Test_InitMsg(msg_t* msg, byte* buffer, int size)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->data = buffer;
+	msg->maxsize = size;
+	msg->allowoverflow = qtrue;
+}
+
+// The game sets it during its frame
+static void Test_Set(int index, const char* value)
+{
+	Proxy_ServerCommand_BeginFrame();
+
+	// Proxy_SharedAPI_SetConfigstring
+	if (!Proxy_ServerCommand_QueueConfigstring(index, value))
+	{
+		Proxy_Configstring_Set(index, value);
+		Test_SetConfigstring(index, value);
+	}
+
+	Proxy_ServerCommand_Flush();
+}
+
+static void Test_Value(char* value, int length, int seed)
+{
+	int i;
+
+	for (i = 0; i < length; i++)
+	{
+		// Some chars above 127 which are sent as '.'
+		value[i] = (char)(1 + (seed * 31 + i * 7) % 255);
+	}
+
+	value[length] = '\0';
+}
+
+static void Test_Queue(void)
+{
+	char value[64];
+	int failures = numFailures, sets, i;
+
+	printf("queue\n");
+
+	Test_Set(100, "first");
+	TEST_CHECK(!strcmp(testServer.configstrings[100], "first"));
+
+	// The same value doesn't reach the engine
+	sets = numEngineSets;
+	Test_Set(100, "first");
+	TEST_CHECK(numEngineSets == sets);
+
+	// Known from the engine the first time
+	Test_SetConfigstring(101, "engine");
+	sets = numEngineSets;
+	Test_Set(101, "engine");
+	TEST_CHECK(numEngineSets == sets);
+	Test_Set(101, "game");
+	TEST_CHECK(numEngineSets == sets + 1 && !strcmp(testServer.configstrings[101], "game"));
+
+	// Enough changes to compact the arena a few times
+	for (i = 0; i < 20000 && numFailures == failures; i++)
+	{
+		int index = 200 + i % 50;
+
+		snprintf(value, sizeof(value), "value %d of %d", i, index);
+		Test_Set(index, value);
+		TEST_CHECK(!strcmp(testServer.configstrings[index], value));
+
+		sets = numEngineSets;
+		Test_Set(index, value);
+		TEST_CHECK(numEngineSets == sets);
+	}
+
+	TEST_CHECK(!strcmp(testServer.configstrings[100], "first"));
+	sets = numEngineSets;
+	Test_Set(100, "first");
+	TEST_CHECK(numEngineSets == sets);
+}
+
+static void Test_Gamestate(void)
+{
+	static byte referenceBuffer[TEST_BUFFER_SIZE], cachedBuffer[TEST_BUFFER_SIZE];
+	static char value[BIG_INFO_STRING];
+	static const int lengths[] = { 0, 1, 6, 7, 8, 50, 1021, BIG_INFO_STRING - 1 };
+	msg_t referenceMsg, cachedMsg;
+	int failures = numFailures, i, offset;
+
+	printf("gamestate\n");
+
+	for (i = 0; i < (int)ARRAY_LEN(lengths); i++)
+	{
+		int index = 300 + i;
+
+		Test_Value(value, lengths[i], i);
+		Test_Set(index, value);
+
+		// The same bits after any bits already written
+		for (offset = 0; offset < 80 && numFailures == failures; offset++)
+		{
+			Test_InitMsg(&referenceMsg, referenceBuffer, sizeof(referenceBuffer));
+			Test_InitMsg(&cachedMsg, cachedBuffer, sizeof(cachedBuffer));
+			Proxy_MSG_HuffmanWriteBits(&referenceMsg, 0x5A5A5A5A, offset % 33);
+			Proxy_MSG_HuffmanWriteBits(&cachedMsg, 0x5A5A5A5A, offset % 33);
+			Proxy_MSG_HuffmanWriteBits(&referenceMsg, 0, offset / 33);
+			Proxy_MSG_HuffmanWriteBits(&cachedMsg, 0, offset / 33);
+
+			Proxy_MSG_HuffmanWriteBigString(&referenceMsg, value);
+			Proxy_Configstring_WriteBigString(&cachedMsg, index);
+
+			// And what comes after it
+			Proxy_MSG_HuffmanWriteBytes(&referenceMsg, 0x1234, 2);
+			Proxy_MSG_HuffmanWriteBytes(&cachedMsg, 0x1234, 2);
+
+			TEST_CHECK(referenceMsg.bit == cachedMsg.bit && referenceMsg.cursize == cachedMsg.cursize);
+			TEST_CHECK(!memcmp(referenceBuffer, cachedBuffer, (referenceMsg.bit + 7) >> 3));
+		}
+	}
+
+	// Close to the end of the message, where it overflows
+	Test_Value(value, 50, 1);
+	Test_Set(320, value);
+
+	for (i = 0; i < 80 && numFailures == failures; i++)
+	{
+		Test_InitMsg(&referenceMsg, referenceBuffer, 40 + i);
+		Test_InitMsg(&cachedMsg, cachedBuffer, 40 + i);
+		Proxy_MSG_HuffmanWriteBits(&referenceMsg, 0, 5);
+		Proxy_MSG_HuffmanWriteBits(&cachedMsg, 0, 5);
+
+		Proxy_MSG_HuffmanWriteBigString(&referenceMsg, value);
+		Proxy_Configstring_WriteBigString(&cachedMsg, 320);
+
+		TEST_CHECK(referenceMsg.bit == cachedMsg.bit && referenceMsg.cursize == cachedMsg.cursize && referenceMsg.overflowed == cachedMsg.overflowed);
+		TEST_CHECK(!memcmp(referenceBuffer, cachedBuffer, (referenceMsg.bit + 7) >> 3));
+	}
+
+	// Changed by the engine without the proxy
+	Test_SetConfigstring(320, "changed by the engine");
+	Test_InitMsg(&referenceMsg, referenceBuffer, sizeof(referenceBuffer));
+	Test_InitMsg(&cachedMsg, cachedBuffer, sizeof(cachedBuffer));
+	Proxy_MSG_HuffmanWriteBigString(&referenceMsg, "changed by the engine");
+	Proxy_Configstring_WriteBigString(&cachedMsg, 320);
+	TEST_CHECK(referenceMsg.bit == cachedMsg.bit && !memcmp(referenceBuffer, cachedBuffer, (referenceMsg.bit + 7) >> 3));
+	TEST_CHECK(Proxy_Configstring_IsCurrent(320, "changed by the engine"));
+}
+
+int main(void)
+{
+	int symbol, i;
+
+	// Codes of all the lengths, the writers don't need them to be a tree
+	for (symbol = 0; symbol < 256; symbol++)
+	{
+		proxyMsgHuffman.lengths[symbol] = 2 + (symbol * 7) % (HUFFMAN_MAX_CODE_LENGTH - 1);
+		proxyMsgHuffman.codes[symbol] = (uint32_t)((symbol * 2654435761U) >> (32 - proxyMsgHuffman.lengths[symbol]));
+	}
+
+	proxyMsgHuffman.ready = qtrue;
+	proxyMsgHuffman.nativeBigString = qtrue;
+	proxy_sv_fastHuffman.integer = 1;
+	proxy_sv_coalesceConfigstrings.integer = 1;
+
+	testTrap.SetConfigstring = Test_SetConfigstring;
+	testTrap.SendServerCommand = Test_SendServerCommand;
+	proxy.trap = &testTrap;
+	proxy.isDefaultEngine = true;
+	server.sv = &testServer;
+
+	for (i = 0; i < MAX_CONFIGSTRINGS; i++)
+	{
+		testServer.configstrings[i] = (char*)"";
+	}
+
+	Test_Queue();
+	Test_Gamestate();
+
+	if (numFailures)
+	{
+		printf("%d failures\n", numFailures);
+
+		return 1;
+	}
+
+	printf("ok\n");
+
+	return 0;
+}
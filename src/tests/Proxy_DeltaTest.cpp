@@ -0,0 +1,361 @@
+// ==================================================
+// Entity delta writer test
+// --------------------------------------------------
+// The native MSG_WriteDeltaEntity of Proxy_msgDelta.cpp,
+// which only walks the changed fields, compared with a
+// writer walking the whole netField table one field at a
+// time with bit by bit MSG_WriteBits like the engine does.
+// The field table is made up here in place of the one
+// read back from the engine: fields in another order than
+// the words, a word which isn't sent, floats and all the
+// field sizes.
+// ==================================================
+
+#include "JKA_YBEProxy/EnginePatch/Proxy_EnginePatch.hpp"
+
+#include <limits.h>
+#include <stdio.h>
+
+#define TEST_BUFFER_SIZE	4096
+
+static int numFailures;
+
+#define TEST_CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			numFailures++; \
+		} \
+	} while (0)
+
+static void Test_PutBit(msg_t* msg, int bit)
+{
+	if (!(msg->bit & 7))
+	{
+		msg->data[msg->bit >> 3] = 0;
+	}
+
+	msg->data[msg->bit >> 3] |= bit << (msg->bit & 7);
+	msg->bit++;
+}
+
+// MSG_WriteBits, one bit at a time
+static void Test_WriteBits(msg_t* msg, int value, int bits)
+{
+	uint32_t bitsLeft = (uint32_t)value;
+	int i;
+
+	if (msg->maxsize - msg->cursize < 4)
+	{
+		msg->overflowed = qtrue;
+
+		return;
+	}
+
+	if (bits < 32)
+	{
+		bitsLeft &= (1U << bits) - 1;
+	}
+
+	for (i = 0; i < (bits & 7); i++, bitsLeft >>= 1)
+	{
+		Test_PutBit(msg, bitsLeft & 1);
+	}
+
+	for (i = 0; i < (bits >> 3); i++, bitsLeft >>= 8)
+	{
+		int symbol = bitsLeft & 0xFF;
+		int j;
+
+		for (j = 0; j < proxyMsgHuffman.lengths[symbol]; j++)
+		{
+			Test_PutBit(msg, (proxyMsgHuffman.codes[symbol] >> j) & 1);
+		}
+	}
+
+	msg->cursize = (msg->bit >> 3) + 1;
+}
+
+// MSG_WriteDeltaEntity with its netField walk
+static void Test_WriteDeltaEntity(msg_t* msg, const entityState_t* from, const entityState_t* to, qboolean force)
+{
+	const int* fromWords = (const int*)from;
+	const int* toWords = (const int*)to;
+	int lc = 0;
+	int i;
+
+	for (i = 0; i < proxyMsgEntityFields.numFields; i++)
+	{
+		int word = proxyMsgEntityFields.fieldWords[i];
+
+		if (fromWords[word] != toWords[word])
+		{
+			lc = i + 1;
+		}
+	}
+
+	if (!lc)
+	{
+		if (!force)
+		{
+			return;
+		}
+
+		Test_WriteBits(msg, to->number, GENTITYNUM_BITS);
+		Test_WriteBits(msg, 0, 1);
+		Test_WriteBits(msg, 0, 1);
+
+		return;
+	}
+
+	Test_WriteBits(msg, to->number, GENTITYNUM_BITS);
+	Test_WriteBits(msg, 0, 1);
+	Test_WriteBits(msg, 1, 1);
+	Test_WriteBits(msg, lc, 8);
+
+	for (i = 0; i < lc; i++)
+	{
+		int word = proxyMsgEntityFields.fieldWords[i];
+		int value = toWords[word];
+
+		if (fromWords[word] == value)
+		{
+			Test_WriteBits(msg, 0, 1);
+			continue;
+		}
+
+		Test_WriteBits(msg, 1, 1);
+
+		if (!proxyMsgEntityFields.fieldBits[i])
+		{
+			float fullFloat;
+			int trunc;
+
+			memcpy(&fullFloat, &value, sizeof(fullFloat));
+
+			// What the x86 conversion gives for the values out of range
+			trunc = fullFloat > -2147483648.0f && fullFloat < 2147483648.0f ? (int)fullFloat : INT_MIN;
+
+			if (fullFloat == 0.0f)
+			{
+				Test_WriteBits(msg, 0, 1);
+			}
+			else if (trunc == fullFloat && trunc + FLOAT_INT_BIAS >= 0 && trunc + FLOAT_INT_BIAS < (1 << FLOAT_INT_BITS))
+			{
+				Test_WriteBits(msg, 1, 1);
+				Test_WriteBits(msg, 0, 1);
+				Test_WriteBits(msg, trunc + FLOAT_INT_BIAS, FLOAT_INT_BITS);
+			}
+			else
+			{
+				Test_WriteBits(msg, 1, 1);
+				Test_WriteBits(msg, 1, 1);
+				Test_WriteBits(msg, value, 32);
+			}
+		}
+		else if (!value)
+		{
+			Test_WriteBits(msg, 0, 1);
+		}
+		else
+		{
+			Test_WriteBits(msg, 1, 1);
+			Test_WriteBits(msg, value, proxyMsgEntityFields.fieldBits[i]);
+		}
+	}
+}
+
+static void Test_InitMsg(msg_t* msg, byte* buffer, int size)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->data = buffer;
+	msg->maxsize = size;
+	msg->allowoverflow = qtrue;
+}
+
+// A permutation of the words but the number and the last one, which aren't sent
+static void Test_BuildFields(void)
+{
+	static const int sizes[] = { 0, 1, 2, 4, 7, 8, 9, 10, 16, 24, 31, 32, 0 };
+	int numFields = ENTITYSTATE_WORDS - 2;
+	int field, word;
+
+	memset(&proxyMsgEntityFields, 0, sizeof(proxyMsgEntityFields));
+
+	for (word = 0; word < ENTITYSTATE_WORDS; word++)
+	{
+		proxyMsgEntityFields.wordFields[word] = -1;
+	}
+
+	for (field = 0; field < numFields; field++)
+	{
+		word = 1 + (field * 37) % numFields;
+
+		proxyMsgEntityFields.fieldWords[field] = (short)word;
+		proxyMsgEntityFields.fieldBits[field] = sizes[field % ARRAY_LEN(sizes)];
+		proxyMsgEntityFields.wordFields[word] = (short)field;
+	}
+}
+
+static int Test_RandomWord(uint32_t* seed)
+{
+	float value;
+	int word;
+
+	*seed = *seed * 1103515245 + 12345;
+
+	switch ((*seed >> 16) % 8)
+	{
+		case 0:
+			return 0;
+		case 1:
+			return (*seed >> 20) & 0xF;
+		case 2:
+			return -1;
+		case 3:
+			value = (float)((int)((*seed >> 8) % (1 << FLOAT_INT_BITS)) - FLOAT_INT_BIAS);
+			break;
+		case 4:
+			value = (float)((*seed >> 8) & 0xFFFF) / 16.0f - 2048.0f;
+			break;
+		case 5:
+			value = (*seed & 0x100) ? (float)FLOAT_INT_BIAS : -0.0f;
+			break;
+		default:
+			return (int)((*seed << 9) ^ (*seed >> 7));
+	}
+
+	memcpy(&word, &value, sizeof(word));
+
+	return word;
+}
+
+static void Test_ChangedWords(const entityState_t* from, const entityState_t* to, uint32_t* changedWords)
+{
+	int word;
+
+	memset(changedWords, 0, ENTITYSTATE_MASK_WORDS * sizeof(uint32_t));
+
+	for (word = 0; word < ENTITYSTATE_WORDS; word++)
+	{
+		if (((const int*)from)[word] != ((const int*)to)[word])
+		{
+			changedWords[word >> 5] |= 1U << (word & 31);
+		}
+	}
+}
+
+static void Test_Deltas(void)
+{
+	static byte referenceBuffer[TEST_BUFFER_SIZE], nativeBuffer[TEST_BUFFER_SIZE];
+	uint32_t changedWords[ENTITYSTATE_MASK_WORDS];
+	entityState_t from, to;
+	msg_t referenceMsg, nativeMsg;
+	uint32_t seed = 0x2003;
+	int failures = numFailures, batch, i, word;
+
+	printf("deltas\n");
+
+	// Batches of deltas in a message, every fourth one overflows it
+	for (batch = 0; batch < 256; batch++)
+	{
+		int maxsize = (batch & 3) ? TEST_BUFFER_SIZE : 64 + batch;
+
+		Test_InitMsg(&referenceMsg, referenceBuffer, maxsize);
+		Test_InitMsg(&nativeMsg, nativeBuffer, maxsize);
+
+		for (i = 0; i < 32; i++)
+		{
+			qboolean force = (qboolean)(i & 1);
+			int numChanges = (batch + i) % 9;
+
+			for (word = 0; word < ENTITYSTATE_WORDS; word++)
+			{
+				((int*)&from)[word] = Test_RandomWord(&seed);
+			}
+
+			to = from;
+
+			// Many changes at once, sometimes
+			if (!(seed & 0x7000))
+			{
+				numChanges = ENTITYSTATE_WORDS;
+			}
+
+			while (numChanges--)
+			{
+				seed = seed * 1103515245 + 12345;
+				((int*)&to)[(seed >> 8) % ENTITYSTATE_WORDS] = Test_RandomWord(&seed);
+			}
+
+			from.number = to.number = (batch * 32 + i) % MAX_GENTITIES;
+
+			Test_WriteDeltaEntity(&referenceMsg, &from, &to, force);
+
+			Test_ChangedWords(&from, &to, changedWords);
+			Proxy_MSG_HuffmanWriteDeltaEntity(&nativeMsg, &from, &to, changedWords, force);
+
+			TEST_CHECK(referenceMsg.bit == nativeMsg.bit && referenceMsg.cursize == nativeMsg.cursize && referenceMsg.overflowed == nativeMsg.overflowed);
+			TEST_CHECK(!memcmp(referenceBuffer, nativeBuffer, (referenceMsg.bit + 7) >> 3));
+
+			if (numFailures != failures)
+			{
+				return;
+			}
+		}
+	}
+}
+
+static void Test_BadFields(void)
+{
+	printf("bad fields\n");
+
+	Test_BuildFields();
+	TEST_CHECK(Proxy_MSG_CheckEntityFields());
+	TEST_CHECK(proxyMsgEntityFields.numFields == ENTITYSTATE_WORDS - 2);
+
+	// Two words for the same field
+	Test_BuildFields();
+	proxyMsgEntityFields.wordFields[ENTITYSTATE_WORDS - 1] = 0;
+	TEST_CHECK(!Proxy_MSG_CheckEntityFields());
+
+	// A field without a word
+	Test_BuildFields();
+	proxyMsgEntityFields.wordFields[proxyMsgEntityFields.fieldWords[3]] = -1;
+	TEST_CHECK(!Proxy_MSG_CheckEntityFields());
+
+	Test_BuildFields();
+	proxyMsgEntityFields.fieldBits[5] = 33;
+	TEST_CHECK(!Proxy_MSG_CheckEntityFields());
+}
+
+int main(void)
+{
+	int symbol;
+
+	// The codes don't matter to the field walk, 8 bits each
+	for (symbol = 0; symbol < 256; symbol++)
+	{
+		proxyMsgHuffman.codes[symbol] = symbol ^ 0x5A;
+		proxyMsgHuffman.lengths[symbol] = 8;
+	}
+
+	Test_BadFields();
+
+	Test_BuildFields();
+	TEST_CHECK(Proxy_MSG_CheckEntityFields());
+	Test_Deltas();
+
+	if (numFailures)
+	{
+		printf("%d failures\n", numFailures);
+
+		return 1;
+	}
+
+	printf("ok\n");
+
+	return 0;
+}
@@ -0,0 +1,148 @@
+// ==================================================
+// Filter rules test
+// --------------------------------------------------
+// The rule lines of proxy_sv_filterFile and the longest
+// prefix matches of the trie of Proxy_FilterRules.cpp.
+// ==================================================
+
+#include "JKA_YBEProxy/Proxy_Header.hpp"
+
+#include <ctype.h>
+#include <stdio.h>
+
+static int numFailures;
+
+#define TEST_CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			numFailures++; \
+		} \
+	} while (0)
+
+// Proxy_Imports.cpp needs the engine, the rules only use this one
+int Q_stricmp(const char* s1, const char* s2)
+{
+	while (*s1 && tolower((byte)*s1) == tolower((byte)*s2))
+	{
+		s1++;
+		s2++;
+	}
+
+	return tolower((byte)*s1) - tolower((byte)*s2);
+}
+
+static uint32_t Test_Ip(int a, int b, int c, int d)
+{
+	return ((uint32_t)a << 24) | ((uint32_t)b << 16) | ((uint32_t)c << 8) | (uint32_t)d;
+}
+
+static void Test_Parse(void)
+{
+	static const char* goodLines[] = {
+		"",
+		"   ",
+		"# comment",
+		"  // comment",
+		"ban 1.2.3.4",
+		"BAN 1.2.3.0/24",
+		"\tallow 1.2.3.4/32",
+		"allow 0.0.0.0/0",
+		"ban 10.0.0.0/8 trailing words",
+	};
+	static const char* badLines[] = {
+		"ban",
+		"ban 1.2.3",
+		"ban 1.2.3.256",
+		"ban 1.2.3.4/33",
+		"ban 1.2.3.4/-1",
+		"ban 1.2.3.4/",
+		"deny 1.2.3.4",
+		"1.2.3.4",
+	};
+	filterRules_t* rules = Proxy_FilterRules_New();
+	size_t i;
+
+	printf("parse\n");
+
+	for (i = 0; i < ARRAY_LEN(goodLines); i++)
+	{
+		if (!Proxy_FilterRules_ParseLine(rules, goodLines[i]))
+		{
+			printf("\"%s\" isn't a rule\n", goodLines[i]);
+			numFailures++;
+		}
+	}
+
+	TEST_CHECK(Proxy_FilterRules_Count(rules) == 5);
+
+	for (i = 0; i < ARRAY_LEN(badLines); i++)
+	{
+		if (Proxy_FilterRules_ParseLine(rules, badLines[i]))
+		{
+			printf("\"%s\" is a rule\n", badLines[i]);
+			numFailures++;
+		}
+	}
+
+	TEST_CHECK(Proxy_FilterRules_Count(rules) == 5);
+
+	Proxy_FilterRules_Free(rules);
+}
+
+static void Test_Match(void)
+{
+	filterRules_t* rules = Proxy_FilterRules_New();
+
+	printf("match\n");
+
+	// No rule
+	TEST_CHECK(Proxy_FilterRules_Match(rules, Test_Ip(1, 2, 3, 4)) == FILTER_NONE);
+
+	TEST_CHECK(Proxy_FilterRules_ParseLine(rules, "ban 10.0.0.0/8"));
+	TEST_CHECK(Proxy_FilterRules_ParseLine(rules, "allow 10.1.0.0/16"));
+	TEST_CHECK(Proxy_FilterRules_ParseLine(rules, "ban 10.1.2.3"));
+	TEST_CHECK(Proxy_FilterRules_ParseLine(rules, "ban 192.168.1.128/25"));
+
+	// The longest prefix wins
+	TEST_CHECK(Proxy_FilterRules_Match(rules, Test_Ip(10, 9, 9, 9)) == FILTER_BAN);
+	TEST_CHECK(Proxy_FilterRules_Match(rules, Test_Ip(10, 1, 9, 9)) == FILTER_ALLOW);
+	TEST_CHECK(Proxy_FilterRules_Match(rules, Test_Ip(10, 1, 2, 3)) == FILTER_BAN);
+	TEST_CHECK(Proxy_FilterRules_Match(rules, Test_Ip(10, 1, 2, 4)) == FILTER_ALLOW);
+	TEST_CHECK(Proxy_FilterRules_Match(rules, Test_Ip(11, 0, 0, 0)) == FILTER_NONE);
+
+	// The bits past the prefix don't matter
+	TEST_CHECK(Proxy_FilterRules_Match(rules, Test_Ip(192, 168, 1, 255)) == FILTER_BAN);
+	TEST_CHECK(Proxy_FilterRules_Match(rules, Test_Ip(192, 168, 1, 128)) == FILTER_BAN);
+	TEST_CHECK(Proxy_FilterRules_Match(rules, Test_Ip(192, 168, 1, 127)) == FILTER_NONE);
+
+	// The last rule of a prefix replaces the previous one
+	TEST_CHECK(Proxy_FilterRules_ParseLine(rules, "allow 10.0.0.0/8"));
+	TEST_CHECK(Proxy_FilterRules_Match(rules, Test_Ip(10, 9, 9, 9)) == FILTER_ALLOW);
+
+	// /0 matches everything not matched by a longer prefix
+	TEST_CHECK(Proxy_FilterRules_ParseLine(rules, "ban 0.0.0.0/0"));
+	TEST_CHECK(Proxy_FilterRules_Match(rules, Test_Ip(11, 0, 0, 0)) == FILTER_BAN);
+	TEST_CHECK(Proxy_FilterRules_Match(rules, Test_Ip(10, 1, 9, 9)) == FILTER_ALLOW);
+
+	Proxy_FilterRules_Free(rules);
+}
+
+int main(void)
+{
+	Test_Parse();
+	Test_Match();
+
+	if (numFailures)
+	{
+		printf("%d failures\n", numFailures);
+
+		return 1;
+	}
+
+	printf("ok\n");
+
+	return 0;
+}
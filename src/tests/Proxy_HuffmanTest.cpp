@@ -0,0 +1,301 @@
+// ==================================================
+// Huffman codec test
+// --------------------------------------------------
+// Round trips of the table driven Huffman codec of
+// Proxy_huffman.cpp. The codes are built here from skewed
+// byte frequencies (so some are longer than the lookup
+// table) in place of the ones read back from the engine,
+// and the writer is compared with a bit by bit writer
+// doing what MSG_WriteBits and Huff_offsetTransmit do.
+// ==================================================
+
+#include "JKA_YBEProxy/EnginePatch/Proxy_EnginePatch.hpp"
+
+#include <stdio.h>
+
+#define TEST_MSG_SIZE		1400
+#define TEST_BUFFER_SIZE	(TEST_MSG_SIZE + 256)	// the writers go a bit past maxsize
+#define TEST_MAX_VALUES		4096
+
+static int numFailures;
+
+#define TEST_CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			printf("%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			numFailures++; \
+		} \
+	} while (0)
+
+// Huffman codes of the frequencies, first bit sent in the lowest bit
+static void Test_BuildCodes(const int* frequencies)
+{
+	int weights[512], parents[512], numNodes = 256, symbol, i;
+	qboolean used[512];
+
+	for (i = 0; i < 256; i++)
+	{
+		weights[i] = frequencies[i];
+		used[i] = qfalse;
+	}
+
+	while (numNodes < 511)
+	{
+		int lowest[2] = { -1, -1 };
+		int j;
+
+		for (j = 0; j < 2; j++)
+		{
+			for (i = 0; i < numNodes; i++)
+			{
+				if (!used[i] && (lowest[j] == -1 || weights[i] < weights[lowest[j]]))
+				{
+					lowest[j] = i;
+				}
+			}
+
+			used[lowest[j]] = qtrue;
+			parents[lowest[j]] = numNodes * 2 + j;	// parent and which child
+		}
+
+		weights[numNodes] = weights[lowest[0]] + weights[lowest[1]];
+		used[numNodes] = qfalse;
+		numNodes++;
+	}
+
+	for (symbol = 0; symbol < 256; symbol++)
+	{
+		uint32_t reversed = 0;
+		int length = 0;
+
+		// From the leaf up, the first bit sent is the one of the root
+		for (i = symbol; i != 510; i = parents[i] >> 1)
+		{
+			reversed = reversed << 1 | (parents[i] & 1);
+			length++;
+		}
+
+		proxyMsgHuffman.codes[symbol] = reversed;
+		proxyMsgHuffman.lengths[symbol] = length;
+	}
+}
+
+// Huff_offsetTransmit
+static void Test_PutCode(msg_t* msg, int symbol)
+{
+	int i;
+
+	for (i = 0; i < proxyMsgHuffman.lengths[symbol]; i++)
+	{
+		if (!(msg->bit & 7))
+		{
+			msg->data[msg->bit >> 3] = 0;
+		}
+
+		msg->data[msg->bit >> 3] |= ((proxyMsgHuffman.codes[symbol] >> i) & 1) << (msg->bit & 7);
+		msg->bit++;
+	}
+}
+
+// MSG_WriteBits of numBytes * 8 bits
+static void Test_WriteBytes(msg_t* msg, uint32_t value, int numBytes)
+{
+	int i;
+
+	if (msg->maxsize - msg->cursize < 4)
+	{
+		msg->overflowed = qtrue;
+
+		return;
+	}
+
+	for (i = 0; i < numBytes; i++, value >>= 8)
+	{
+		Test_PutCode(msg, value & 0xFF);
+	}
+
+	msg->cursize = (msg->bit >> 3) + 1;
+}
+
+static void Test_InitMsg(msg_t* msg, byte* buffer, int size)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->data = buffer;
+	msg->maxsize = size;
+	msg->allowoverflow = qtrue;
+}
+
+static void Test_RoundTrip(const char* name)
+{
+	static byte referenceBuffer[TEST_BUFFER_SIZE], tablesBuffer[TEST_BUFFER_SIZE];
+	static byte values[TEST_MAX_VALUES * 4];
+	msg_t referenceMsg, tablesMsg;
+	uint32_t seed = 0x2003;
+	int failures = numFailures, numValues = 0, i;
+
+	printf("%s\n", name);
+
+	TEST_CHECK(Proxy_MSG_HuffmanBuildTables());
+
+	Test_InitMsg(&referenceMsg, referenceBuffer, TEST_MSG_SIZE);
+	Test_InitMsg(&tablesMsg, tablesBuffer, TEST_MSG_SIZE);
+
+	// Every byte, then random bytes, shorts and longs until both overflow
+	for (i = 0; !referenceMsg.overflowed || !tablesMsg.overflowed; i++)
+	{
+		int numBytes, j;
+		uint32_t value;
+
+		seed = seed * 1103515245 + 12345;
+		value = i < 256 ? i : (seed >> 8) ^ (seed << 13);
+		numBytes = i < 256 ? 1 : 1 << (seed % 3);
+
+		Test_WriteBytes(&referenceMsg, value, numBytes);
+		Proxy_MSG_HuffmanWriteBytes(&tablesMsg, value, numBytes);
+
+		TEST_CHECK(referenceMsg.bit == tablesMsg.bit && referenceMsg.cursize == tablesMsg.cursize && referenceMsg.overflowed == tablesMsg.overflowed);
+
+		if (numFailures != failures)
+		{
+			return;
+		}
+
+		for (j = 0; !tablesMsg.overflowed && j < numBytes && numValues < (int)sizeof(values); j++)
+		{
+			values[numValues++] = (byte)(value >> (j * 8));
+		}
+	}
+
+	TEST_CHECK(!memcmp(referenceBuffer, tablesBuffer, referenceMsg.cursize));
+
+	// The last codes are read from the tree, the lookup needs 2 more bytes
+	tablesMsg.maxsize = tablesMsg.cursize;
+	tablesMsg.bit = 0;
+
+	for (i = 0; i < numValues; i++)
+	{
+		int symbol = Proxy_MSG_HuffmanReceive(&tablesMsg);
+
+		if (symbol != values[i])
+		{
+			TEST_CHECK(symbol == values[i]);
+			return;
+		}
+	}
+
+	TEST_CHECK(tablesMsg.bit == referenceMsg.bit);
+}
+
+static void Test_BigString(void)
+{
+	static byte referenceBuffer[BIG_INFO_STRING * 2], tablesBuffer[BIG_INFO_STRING * 2];
+	char string[MAX_STRING_CHARS];
+	msg_t referenceMsg, tablesMsg;
+	const byte* c;
+	int i;
+
+	printf("big string\n");
+
+	// Every char but 0, those above 127 are sent as '.'
+	for (i = 0; i < (int)sizeof(string) - 1; i++)
+	{
+		string[i] = (char)(1 + i % 255);
+	}
+
+	string[sizeof(string) - 1] = '\0';
+
+	Test_InitMsg(&referenceMsg, referenceBuffer, sizeof(referenceBuffer));
+	Test_InitMsg(&tablesMsg, tablesBuffer, sizeof(tablesBuffer));
+
+	c = (const byte*)string;
+
+	do
+	{
+		Test_WriteBytes(&referenceMsg, *c > 127 ? '.' : *c, 1);
+	} while (*c++);
+
+	Proxy_MSG_HuffmanWriteBigString(&tablesMsg, string);
+
+	TEST_CHECK(referenceMsg.bit == tablesMsg.bit && referenceMsg.cursize == tablesMsg.cursize);
+	TEST_CHECK(!memcmp(referenceBuffer, tablesBuffer, referenceMsg.cursize));
+}
+
+static void Test_BadCodes(void)
+{
+	int frequencies[256], i;
+
+	printf("bad codes\n");
+
+	for (i = 0; i < 256; i++)
+	{
+		frequencies[i] = 1;
+	}
+
+	// The code of 1 is a prefix of the one of 0
+	Test_BuildCodes(frequencies);
+	proxyMsgHuffman.codes[1] = proxyMsgHuffman.codes[0];
+	proxyMsgHuffman.lengths[1] = proxyMsgHuffman.lengths[0] - 1;
+	TEST_CHECK(!Proxy_MSG_HuffmanBuildTables());
+
+	// Two symbols with the same code
+	Test_BuildCodes(frequencies);
+	proxyMsgHuffman.codes[1] = proxyMsgHuffman.codes[0];
+	TEST_CHECK(!Proxy_MSG_HuffmanBuildTables());
+
+	Test_BuildCodes(frequencies);
+	proxyMsgHuffman.lengths[2] = 0;
+	TEST_CHECK(!Proxy_MSG_HuffmanBuildTables());
+
+	Test_BuildCodes(frequencies);
+	proxyMsgHuffman.lengths[2] = HUFFMAN_MAX_CODE_LENGTH + 1;
+	TEST_CHECK(!Proxy_MSG_HuffmanBuildTables());
+}
+
+int main(void)
+{
+	int frequencies[256], longest = 0, i;
+
+	// Same length codes, all read through the table
+	for (i = 0; i < 256; i++)
+	{
+		frequencies[i] = 1;
+	}
+
+	Test_BuildCodes(frequencies);
+	Test_RoundTrip("flat codes");
+
+	// A few frequent bytes push the others past MSG_HUFFMAN_TABLE_BITS
+	for (i = 0; i < 256; i++)
+	{
+		frequencies[i] = i < 16 ? 1 << (20 - i) : 1 + i % 3;
+	}
+
+	Test_BuildCodes(frequencies);
+
+	for (i = 0; i < 256; i++)
+	{
+		if (proxyMsgHuffman.lengths[i] > longest)
+		{
+			longest = proxyMsgHuffman.lengths[i];
+		}
+	}
+
+	TEST_CHECK(longest > MSG_HUFFMAN_TABLE_BITS && longest <= HUFFMAN_MAX_CODE_LENGTH);
+	Test_RoundTrip("skewed codes");
+	Test_BigString();
+
+	Test_BadCodes();
+
+	if (numFailures)
+	{
+		printf("%d failures\n", numFailures);
+
+		return 1;
+	}
+
+	printf("ok\n");
+
+	return 0;
+}
@@ -0,0 +1,125 @@
+// ==================================================
+// Loopback load generator
+// --------------------------------------------------
+// Sends sequenced datagrams to a server from a number of
+// sources (one socket each, like as many clients) at a
+// fixed total rate, 32 sources at 125 packets per second
+// by default, and counts what the server sends back (the
+// engine answers a sequenced packet from an unknown address
+// with a disconnect). Used to load the recvmmsg thread of
+// proxy_sv_netThread, compare the server frame times and
+// the answers with proxy_sv_netThread 0 and 1.
+//
+// Usage: Proxy_LoadGenerator <ip>:<port> [packets/s] [size] [seconds] [sources]
+// ==================================================
+
+#include "Proxy_Tools.hpp"
+
+#define LOAD_MAX_SOURCES	1024
+#define LOAD_MAX_SIZE		1400
+
+int main(int argc, char** argv)
+{
+	static int sockets[LOAD_MAX_SOURCES];
+	unsigned char packet[LOAD_MAX_SIZE], reply[LOAD_MAX_SIZE];
+	struct sockaddr_in server;
+	int rate = argc > 2 ? atoi(argv[2]) : 4000;
+	int size = argc > 3 ? atoi(argv[3]) : 64;
+	int seconds = argc > 4 ? atoi(argv[4]) : 10;
+	int numSources = argc > 5 ? atoi(argv[5]) : 32;
+	long long sent = 0, failed = 0, replies = 0, total = 0;
+	uint32_t sequence = 1;
+	int64_t start, nextReport;
+	int i, source = 0;
+
+	if (argc < 2 || !Tools_ParseAddress(argv[1], &server))
+	{
+		fprintf(stderr, "Usage: %s <ip>:<port> [packets/s] [size] [seconds] [sources]\n", argv[0]);
+
+		return 1;
+	}
+
+	if (rate <= 0 || size < 8 || size > LOAD_MAX_SIZE || seconds <= 0 || numSources <= 0 || numSources > LOAD_MAX_SOURCES)
+	{
+		fprintf(stderr, "Bad parameters\n");
+
+		return 1;
+	}
+
+	for (i = 0; i < numSources; i++)
+	{
+		sockets[i] = Tools_OpenSocket();
+	}
+
+	memset(packet, 0, sizeof(packet));
+
+	printf("%d packets/s of %d bytes to %s from %d sources for %d s\n", rate, size, argv[1], numSources, seconds);
+
+	start = Tools_Microseconds();
+	nextReport = start + 1000000;
+
+	for (;;)
+	{
+		int64_t now = Tools_Microseconds();
+		long long due = (now - start) * rate / 1000000;
+
+		if (now - start >= (int64_t)seconds * 1000000)
+		{
+			break;
+		}
+
+		// The packets due by now, then sleep until the next one
+		while (total < due)
+		{
+			// Sequence and qport like a client packet, the rest doesn't matter
+			memcpy(packet, &sequence, 4);
+			packet[4] = (unsigned char)source;
+			packet[5] = (unsigned char)(source >> 8);
+
+			if (sendto(sockets[source], packet, size, 0, (struct sockaddr*)&server, sizeof(server)) == size)
+			{
+				sent++;
+			}
+			else
+			{
+				failed++;
+			}
+
+			total++;
+			source = (source + 1) % numSources;
+
+			if (!source)
+			{
+				sequence++;
+			}
+		}
+
+		for (i = 0; i < numSources; i++)
+		{
+			while (recv(sockets[i], reply, sizeof(reply), 0) > 0)
+			{
+				replies++;
+			}
+		}
+
+		if (now >= nextReport)
+		{
+			printf("sent %lld, failed %lld, replies %lld\n", sent, failed, replies);
+			fflush(stdout);
+
+			sent = failed = replies = 0;
+			nextReport += 1000000;
+		}
+
+		usleep(500);
+	}
+
+	printf("sent %lld, failed %lld, replies %lld\n", sent, failed, replies);
+
+	for (i = 0; i < numSources; i++)
+	{
+		close(sockets[i]);
+	}
+
+	return 0;
+}
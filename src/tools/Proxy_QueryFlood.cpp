@@ -0,0 +1,152 @@
+// ==================================================
+// Query flooder
+// --------------------------------------------------
+// Sends getstatus or getinfo queries to a server from a
+// number of sources at a fixed total rate, each with its
+// own challenge, and checks the answers once per second:
+// an answer must carry the challenge of a query of the
+// socket it arrives on (the cached responses of
+// proxy_sv_queryCache get the challenge spliced in).
+// With proxy_sv_queryRate the answers of a source stop at
+// that rate.
+//
+// Usage: Proxy_QueryFlood <ip>:<port> [queries/s] [seconds] [getstatus|getinfo] [sources]
+// ==================================================
+
+#include "Proxy_Tools.hpp"
+
+#define FLOOD_MAX_SOURCES	1024
+
+typedef struct floodStats_s
+{
+	long long	sent;
+	long long	answered;
+	long long	badChallenge;
+} floodStats_t;
+
+// The challenge of the answer, -1 if it has none
+static long long Flood_Challenge(const char* answer)
+{
+	const char* challenge = strstr(answer, "\\challenge\\");
+
+	if (!challenge)
+	{
+		return -1;
+	}
+
+	return strtoll(challenge + 11, NULL, 10);
+}
+
+static void Flood_Report(const floodStats_t* stats)
+{
+	printf("sent %lld, answered %lld, bad challenge %lld\n", stats->sent, stats->answered, stats->badChallenge);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	static int sockets[FLOOD_MAX_SOURCES];
+	static long long lastChallenges[FLOOD_MAX_SOURCES];
+	char query[64], answer[16384];
+	struct sockaddr_in server;
+	int rate = argc > 2 ? atoi(argv[2]) : 1000;
+	int seconds = argc > 3 ? atoi(argv[3]) : 10;
+	const char* command = argc > 4 ? argv[4] : "getstatus";
+	int numSources = argc > 5 ? atoi(argv[5]) : 16;
+	long long total = 0;
+	floodStats_t stats;
+	int64_t start, nextReport;
+	int i, source = 0;
+
+	if (argc < 2 || !Tools_ParseAddress(argv[1], &server))
+	{
+		fprintf(stderr, "Usage: %s <ip>:<port> [queries/s] [seconds] [getstatus|getinfo] [sources]\n", argv[0]);
+
+		return 1;
+	}
+
+	if (rate <= 0 || seconds <= 0 || numSources <= 0 || numSources > FLOOD_MAX_SOURCES
+		|| (strcmp(command, "getstatus") && strcmp(command, "getinfo")))
+	{
+		fprintf(stderr, "Bad parameters\n");
+
+		return 1;
+	}
+
+	for (i = 0; i < numSources; i++)
+	{
+		sockets[i] = Tools_OpenSocket();
+		lastChallenges[i] = -1;
+	}
+
+	printf("%d %s/s to %s from %d sources for %d s\n", rate, command, argv[1], numSources, seconds);
+
+	memset(&stats, 0, sizeof(stats));
+	start = Tools_Microseconds();
+	nextReport = start + 1000000;
+
+	for (;;)
+	{
+		int64_t now = Tools_Microseconds();
+		long long due = (now - start) * rate / 1000000;
+
+		// A last second for the answers
+		if (now - start >= (int64_t)(seconds + 1) * 1000000)
+		{
+			break;
+		}
+
+		while (total < due && now - start < (int64_t)seconds * 1000000)
+		{
+			// The challenges of a source only go up, an answer can't be newer than the last query
+			int length = snprintf(query, sizeof(query), "\xff\xff\xff\xff%s %lld", command, total);
+
+			if (sendto(sockets[source], query, length, 0, (struct sockaddr*)&server, sizeof(server)) == length)
+			{
+				lastChallenges[source] = total;
+				stats.sent++;
+			}
+
+			total++;
+			source = (source + 1) % numSources;
+		}
+
+		for (i = 0; i < numSources; i++)
+		{
+			ssize_t length;
+
+			while ((length = recv(sockets[i], answer, sizeof(answer) - 1, 0)) > 0)
+			{
+				long long challenge;
+
+				answer[length] = '\0';
+				challenge = Flood_Challenge(answer);
+				stats.answered++;
+
+				if (challenge < 0 || challenge > lastChallenges[i] || challenge % numSources != i)
+				{
+					stats.badChallenge++;
+				}
+			}
+		}
+
+		if (now >= nextReport)
+		{
+			Flood_Report(&stats);
+
+			memset(&stats, 0, sizeof(stats));
+			nextReport += 1000000;
+		}
+
+		usleep(500);
+	}
+
+	Flood_Report(&stats);
+
+	for (i = 0; i < numSources; i++)
+	{
+		close(sockets[i]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,208 @@
+// ==================================================
+// Relay stand-in
+// --------------------------------------------------
+// Listens on the Unix datagram socket the proxy sends
+// the messages of the relay slot to (proxy_sv_relayPath),
+// checks the stream and fans every datagram out to the
+// UDP viewers given on the command line.
+// Prints once per second what it got: the gamestates,
+// the snapshots and the holes in the netchan sequences,
+// a hole is followed by a snapshot without delta sent by
+// Proxy_Relay_RunFrame.
+//
+// Usage: Proxy_RelayStandIn <path> [<ip>:<port> ...]
+// ==================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define RELAY_MAGIC				0x5942524C	// "YBRL"
+
+#define RELAY_MESSAGE_GAMESTATE	0
+#define RELAY_MESSAGE_SNAPSHOT	1
+
+#define RELAY_MAX_DATAGRAM		65536
+#define RELAY_MAX_VIEWERS		64
+
+// Same layout as relayHeader_t of Proxy_Relay.cpp
+typedef struct relayHeader_s
+{
+	int32_t		magic;
+	int32_t		type;
+	int32_t		sequence;
+	int32_t		serverTime;
+	int32_t		clientNum;
+	int32_t		length;
+} relayHeader_t;
+
+typedef struct relayStats_s
+{
+	int			gamestates;
+	int			snapshots;
+	int			holes;
+	int			bad;
+	long long	bytes;
+} relayStats_t;
+
+static int Relay_ParseViewer(const char* text, struct sockaddr_in* address)
+{
+	char ip[64];
+	const char* colon = strrchr(text, ':');
+
+	if (!colon || colon - text >= (int)sizeof(ip))
+	{
+		return 0;
+	}
+
+	memcpy(ip, text, colon - text);
+	ip[colon - text] = '\0';
+
+	memset(address, 0, sizeof(*address));
+	address->sin_family = AF_INET;
+	address->sin_port = htons((uint16_t)atoi(colon + 1));
+
+	return inet_pton(AF_INET, ip, &address->sin_addr) == 1;
+}
+
+int main(int argc, char** argv)
+{
+	static unsigned char datagram[RELAY_MAX_DATAGRAM];
+	struct sockaddr_in viewers[RELAY_MAX_VIEWERS];
+	struct sockaddr_un address;
+	relayStats_t stats;
+	relayHeader_t header;
+	int numViewers = 0, relaySocket, viewerSocket, lastSequence = 0, i;
+	time_t lastReport;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s <path> [<ip>:<port> ...]\n", argv[0]);
+
+		return 1;
+	}
+
+	if (strlen(argv[1]) >= sizeof(address.sun_path))
+	{
+		fprintf(stderr, "%s is too long\n", argv[1]);
+
+		return 1;
+	}
+
+	for (i = 2; i < argc && numViewers < RELAY_MAX_VIEWERS; i++)
+	{
+		if (!Relay_ParseViewer(argv[i], &viewers[numViewers]))
+		{
+			fprintf(stderr, "Bad viewer address %s\n", argv[i]);
+
+			return 1;
+		}
+
+		numViewers++;
+	}
+
+	relaySocket = socket(AF_UNIX, SOCK_DGRAM, 0);
+	viewerSocket = socket(AF_INET, SOCK_DGRAM, 0);
+
+	if (relaySocket == -1 || viewerSocket == -1)
+	{
+		fprintf(stderr, "Can't create the sockets (%s)\n", strerror(errno));
+
+		return 1;
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, argv[1]);
+	unlink(argv[1]);
+
+	if (bind(relaySocket, (struct sockaddr*)&address, sizeof(address)) == -1)
+	{
+		fprintf(stderr, "Can't bind %s (%s)\n", argv[1], strerror(errno));
+
+		return 1;
+	}
+
+	printf("Relaying %s to %d viewers\n", argv[1], numViewers);
+
+	memset(&stats, 0, sizeof(stats));
+	lastReport = time(NULL);
+
+	for (;;)
+	{
+		ssize_t length = recv(relaySocket, datagram, sizeof(datagram), 0);
+
+		if (length == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			fprintf(stderr, "recv failed (%s)\n", strerror(errno));
+
+			break;
+		}
+
+		if (length < (ssize_t)sizeof(header))
+		{
+			stats.bad++;
+
+			continue;
+		}
+
+		memcpy(&header, datagram, sizeof(header));
+
+		if (header.magic != RELAY_MAGIC || header.length != length - (ssize_t)sizeof(header))
+		{
+			stats.bad++;
+
+			continue;
+		}
+
+		if (header.type == RELAY_MESSAGE_GAMESTATE)
+		{
+			stats.gamestates++;
+		}
+		else
+		{
+			stats.snapshots++;
+
+			if (lastSequence && header.sequence != lastSequence + 1)
+			{
+				stats.holes++;
+			}
+		}
+
+		lastSequence = header.sequence;
+		stats.bytes += length;
+
+		for (i = 0; i < numViewers; i++)
+		{
+			sendto(viewerSocket, datagram, length, MSG_DONTWAIT, (struct sockaddr*)&viewers[i], sizeof(viewers[i]));
+		}
+
+		if (time(NULL) != lastReport)
+		{
+			printf("client %d time %d: %d gamestates, %d snapshots, %d holes, %d bad, %lld bytes\n",
+				header.clientNum, header.serverTime, stats.gamestates, stats.snapshots, stats.holes, stats.bad, stats.bytes);
+			fflush(stdout);
+
+			memset(&stats, 0, sizeof(stats));
+			lastReport = time(NULL);
+		}
+	}
+
+	close(relaySocket);
+	close(viewerSocket);
+
+	return 1;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// ==================================================
+// Helpers shared by the tools exercising the proxy
+// ==================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// "<ip>:<port>"
+static inline int Tools_ParseAddress(const char* text, struct sockaddr_in* address)
+{
+	char ip[64];
+	const char* colon = strrchr(text, ':');
+
+	if (!colon || colon - text >= (int)sizeof(ip))
+	{
+		return 0;
+	}
+
+	memcpy(ip, text, colon - text);
+	ip[colon - text] = '\0';
+
+	memset(address, 0, sizeof(*address));
+	address->sin_family = AF_INET;
+	address->sin_port = htons((uint16_t)atoi(colon + 1));
+
+	return inet_pton(AF_INET, ip, &address->sin_addr) == 1;
+}
+
+static inline int64_t Tools_Microseconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// Non blocking UDP socket on an ephemeral port
+static inline int Tools_OpenSocket(void)
+{
+	int s = socket(AF_INET, SOCK_DGRAM, 0);
+
+	if (s == -1)
+	{
+		fprintf(stderr, "Can't create a socket (%s)\n", strerror(errno));
+		exit(1);
+	}
+
+	fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+
+	return s;
+}
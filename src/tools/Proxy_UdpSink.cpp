@@ -0,0 +1,209 @@
+// ==================================================
+// UDP sink
+// --------------------------------------------------
+// Counts the datagrams it gets once per second: netchan
+// packets, fragments, out of band packets, and the holes
+// and reorders in the netchan sequences of each source.
+// With a server address it sits between a client and the
+// server instead: the first other address is the client,
+// every packet is forwarded both ways and only what the
+// server sends is counted. Used to check that the batched
+// (and GSO) sends of proxy_sv_netBatch all arrive, in
+// order, like with proxy_sv_netBatch 0.
+//
+// Usage: Proxy_UdpSink <port> [<server ip>:<port>]
+// ==================================================
+
+#include "Proxy_Tools.hpp"
+
+#define SINK_MAX_SOURCES	256
+#define SINK_FRAGMENT_BIT	(1U << 31)
+
+typedef struct sinkSource_s
+{
+	struct sockaddr_in	address;
+	uint32_t			lastSequence;
+} sinkSource_t;
+
+typedef struct sinkStats_s
+{
+	long long	packets;
+	long long	bytes;
+	int			fragments;
+	int			outOfBand;
+	int			holes;
+	int			reordered;
+} sinkStats_t;
+
+static sinkSource_t sources[SINK_MAX_SOURCES];
+static int numSources;
+
+static int Sink_SameAddress(const struct sockaddr_in* a, const struct sockaddr_in* b)
+{
+	return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+static sinkSource_t* Sink_Source(const struct sockaddr_in* address)
+{
+	int i;
+
+	for (i = 0; i < numSources; i++)
+	{
+		if (Sink_SameAddress(&sources[i].address, address))
+		{
+			return &sources[i];
+		}
+	}
+
+	if (numSources == SINK_MAX_SOURCES)
+	{
+		return NULL;
+	}
+
+	sources[numSources].address = *address;
+	sources[numSources].lastSequence = 0;
+
+	return &sources[numSources++];
+}
+
+static void Sink_Count(sinkStats_t* stats, const struct sockaddr_in* from, const unsigned char* data, int length)
+{
+	sinkSource_t* source;
+	uint32_t header, sequence;
+
+	stats->packets++;
+	stats->bytes += length;
+
+	if (length < 4)
+	{
+		return;
+	}
+
+	memcpy(&header, data, 4);
+
+	if (header == 0xFFFFFFFFU)
+	{
+		stats->outOfBand++;
+
+		return;
+	}
+
+	sequence = header & ~SINK_FRAGMENT_BIT;
+
+	if (header & SINK_FRAGMENT_BIT)
+	{
+		stats->fragments++;
+	}
+
+	source = Sink_Source(from);
+
+	if (!source)
+	{
+		return;
+	}
+
+	// The fragments of a message have its sequence
+	if (source->lastSequence && sequence > source->lastSequence + 1)
+	{
+		stats->holes += sequence - source->lastSequence - 1;
+	}
+	else if (sequence < source->lastSequence)
+	{
+		stats->reordered++;
+
+		return;
+	}
+
+	source->lastSequence = sequence;
+}
+
+int main(int argc, char** argv)
+{
+	static unsigned char datagram[65536];
+	struct sockaddr_in address, server, client, from;
+	int haveServer = 0, haveClient = 0, s;
+	sinkStats_t stats;
+	int64_t nextReport;
+
+	if (argc < 2 || (argc > 2 && !Tools_ParseAddress(argv[2], &server)))
+	{
+		fprintf(stderr, "Usage: %s <port> [<server ip>:<port>]\n", argv[0]);
+
+		return 1;
+	}
+
+	haveServer = argc > 2;
+	s = Tools_OpenSocket();
+
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons((uint16_t)atoi(argv[1]));
+
+	if (bind(s, (struct sockaddr*)&address, sizeof(address)) == -1)
+	{
+		fprintf(stderr, "Can't bind port %s (%s)\n", argv[1], strerror(errno));
+
+		return 1;
+	}
+
+	printf(haveServer ? "Forwarding port %s to %s\n" : "Sink on port %s\n", argv[1], argc > 2 ? argv[2] : "");
+
+	memset(&stats, 0, sizeof(stats));
+	nextReport = Tools_Microseconds() + 1000000;
+
+	for (;;)
+	{
+		socklen_t fromLength = sizeof(from);
+		ssize_t length = recvfrom(s, datagram, sizeof(datagram), 0, (struct sockaddr*)&from, &fromLength);
+
+		if (length >= 0)
+		{
+			if (!haveServer)
+			{
+				Sink_Count(&stats, &from, datagram, (int)length);
+			}
+			else if (Sink_SameAddress(&from, &server))
+			{
+				Sink_Count(&stats, &from, datagram, (int)length);
+
+				if (haveClient)
+				{
+					sendto(s, datagram, length, 0, (struct sockaddr*)&client, sizeof(client));
+				}
+			}
+			else
+			{
+				if (!haveClient)
+				{
+					client = from;
+					haveClient = 1;
+				}
+
+				if (Sink_SameAddress(&from, &client))
+				{
+					sendto(s, datagram, length, 0, (struct sockaddr*)&server, sizeof(server));
+				}
+			}
+		}
+		else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+		{
+			usleep(200);
+		}
+		else
+		{
+			fprintf(stderr, "recvfrom failed (%s)\n", strerror(errno));
+
+			return 1;
+		}
+
+		if (Tools_Microseconds() >= nextReport)
+		{
+			printf("%lld packets, %lld bytes, %d fragments, %d out of band, %d holes, %d reordered\n",
+				stats.packets, stats.bytes, stats.fragments, stats.outOfBand, stats.holes, stats.reordered);
+			fflush(stdout);
+
+			memset(&stats, 0, sizeof(stats));
+			nextReport += 1000000;
+		}
+	}
+}